@@ -0,0 +1,140 @@
+// BvhBench.cpp
+// Query cost of InstanceBvh against a linear pass over the same instance
+// boxes, for 1k to 1M instances at constant density: frustum culling (a view
+// of fixed depth, so the visible count stays about the same), closest ray
+// hits and nearest-instance queries, plus the build and refit times.
+// Usage: BvhBench [maxInstances]
+#include "InstanceBvh.h"
+#include "FrustumCulling.h"
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Best-of-N wall time in milliseconds
+static double timeBest(int runs, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Instances of size 0.5 to 1.5 spread over a cube holding about one per 64 cubic units
+static void makeInstances(size_t count, std::mt19937& rng, AabbList& boxes, float& side) {
+    side = 4.0f * std::cbrt(static_cast<float>(count));
+    std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side), extent(0.25f, 0.75f);
+    boxes.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 center(position(rng), position(rng), position(rng));
+        const glm::vec3 half(extent(rng), extent(rng), extent(rng));
+        boxes.set(i, center - half, center + half);
+    }
+}
+
+static float rayBox(const AabbList& boxes, size_t i, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    const glm::vec3 t0 = (glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]) - origin) * inverseDirection;
+    const glm::vec3 t1 = (glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]) - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    const float entry = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+    const float exit = std::min({ tFar.x, tFar.y, tFar.z, maxDistance });
+    return entry <= exit ? entry : maxDistance;
+}
+
+static float boxDistance(const AabbList& boxes, size_t i, const glm::vec3& point) {
+    const glm::vec3 min(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), max(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+    const glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+    return std::sqrt(glm::dot(d, d));
+}
+
+int main(int argc, char** argv) {
+    const size_t maxInstances = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const int rayCount = 1000;
+    std::mt19937 rng(7);
+
+    std::printf("%9s %9s %8s | %-23s | %-23s | %-23s\n", "instances", "build ms", "refit ms",
+                "frustum ms  bvh / linear", "ray us     bvh / linear", "nearest us bvh / linear");
+    int mismatches = 0;
+    for (size_t count = 1000; count <= maxInstances; count *= 10) {
+        AabbList boxes;
+        float side;
+        makeInstances(count, rng, boxes, side);
+
+        InstanceBvh bvh;
+        const double buildMs = timeBest(3, [&] { bvh.build(boxes); });
+        const double refitMs = timeBest(3, [&] { bvh.refit(boxes); });
+
+        // 60 degree view from the centre, 40 units deep
+        const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 40.0f) *
+                                         glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const Frustum frustum = Frustum::FromMatrix(viewProjection);
+        std::vector<uint32_t> bvhVisible, linearVisible(count);
+        size_t linearCount = 0;
+        const double bvhCullMs = timeBest(5, [&] {
+            bvhVisible.clear();
+            bvh.cull(frustum, bvhVisible);
+        });
+        const double linearCullMs = timeBest(5, [&] { linearCount = FrustumCuller::Cull(frustum, boxes, linearVisible.data()); });
+        if (bvhVisible.size() != linearCount) ++mismatches;
+
+        // Rays from random points inside the cube in random directions
+        std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side), direction(-1.0f, 1.0f);
+        std::vector<glm::vec3> origins(rayCount), directions(rayCount);
+        for (int r = 0; r < rayCount; ++r) {
+            origins[r] = glm::vec3(position(rng), position(rng), position(rng));
+            directions[r] = glm::normalize(glm::vec3(direction(rng), direction(rng), direction(rng)));
+        }
+        const float maxDistance = 2.0f * side;
+        std::vector<float> bvhHits(rayCount), linearHits(rayCount);
+        const double bvhRayMs = timeBest(3, [&] {
+            for (int r = 0; r < rayCount; ++r) {
+                float distance;
+                bvh.raycast(origins[r], directions[r], maxDistance, distance);
+                bvhHits[r] = distance;
+            }
+        });
+        // The linear pass gets a tenth of the rays at the large sizes
+        const int linearRays = count >= 100000 ? rayCount / 10 : rayCount;
+        const double linearRayMs = timeBest(1, [&] {
+            for (int r = 0; r < linearRays; ++r) {
+                const glm::vec3 inverseDirection = glm::vec3(1.0f) / directions[r];
+                float closest = maxDistance;
+                for (size_t i = 0; i < count; ++i) closest = std::min(closest, rayBox(boxes, i, origins[r], inverseDirection, closest));
+                linearHits[r] = closest;
+            }
+        });
+        for (int r = 0; r < linearRays; ++r) {
+            if (std::fabs(bvhHits[r] - linearHits[r]) > 1e-3f) ++mismatches;
+        }
+
+        std::vector<float> bvhNearest(rayCount), linearNearest(rayCount);
+        const double bvhNearestMs = timeBest(3, [&] {
+            for (int r = 0; r < rayCount; ++r) bvh.nearest(origins[r], maxDistance, bvhNearest[r]);
+        });
+        const double linearNearestMs = timeBest(1, [&] {
+            for (int r = 0; r < linearRays; ++r) {
+                float closest = maxDistance;
+                for (size_t i = 0; i < count; ++i) closest = std::min(closest, boxDistance(boxes, i, origins[r]));
+                linearNearest[r] = closest;
+            }
+        });
+        for (int r = 0; r < linearRays; ++r) {
+            if (std::fabs(bvhNearest[r] - linearNearest[r]) > 1e-3f) ++mismatches;
+        }
+
+        std::printf("%9zu %9.2f %8.2f | %9.3f / %9.3f | %9.2f / %9.2f | %9.2f / %9.2f   (%zu visible)\n", count, buildMs, refitMs,
+                    bvhCullMs, linearCullMs, 1000.0 * bvhRayMs / rayCount, 1000.0 * linearRayMs / linearRays,
+                    1000.0 * bvhNearestMs / rayCount, 1000.0 * linearNearestMs / linearRays, linearCount);
+    }
+    if (mismatches > 0) std::printf("%d results differ between the BVH and the linear pass\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// CrowdBench.cpp
+// Frame time of a crowd of one Model at 1, 100, 10k and 100k instances, drawn
+// with Model::DrawInstanced (one draw per material group) and, up to 10k, with
+// one Model::Draw per instance for comparison. Needs a GL 3.3 context; the window stays hidden.
+// Usage: CrowdBench [file.obj file.mtl]   (run from the build directory, like SphereLighting)
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include "RenderQueue.h"
+#include "ShaderVariants.h"
+#include "GeometryArena.h"
+#include "UniformBuffers.h"
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+static const uint32_t lightCount = 1;
+
+// Instances on a square grid in the XZ plane, one unit apart, with a tint pattern
+static void makeCrowd(size_t count, std::vector<glm::mat4>& transforms, std::vector<glm::vec3>& tints) {
+    const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    transforms.resize(count);
+    tints.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float x = static_cast<float>(i % side) - 0.5f * side;
+        const float z = static_cast<float>(i / side) - 0.5f * side;
+        transforms[i] = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z)), 0.37f * i, glm::vec3(0.0f, 1.0f, 0.0f));
+        tints[i] = glm::vec3(0.6f + 0.4f * ((i * 7) % 5) / 4.0f, 0.6f + 0.4f * ((i * 3) % 7) / 6.0f, 1.0f);
+    }
+}
+
+// Camera above the crowd looking at its centre, far enough back to frame all of it
+static void beginFrame(size_t count) {
+    const float extent = std::max(4.0f, std::sqrt(static_cast<float>(count)));
+    FrameUniforms frame{};
+    const glm::vec3 eye(0.0f, 0.6f * extent, 0.9f * extent);
+    frame.view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 4.0f * extent);
+    frame.viewPos = glm::vec4(eye, 1.0f);
+    frame.lightPos[0] = glm::vec4(0.0f, extent, 0.0f, 1.0f);
+    frame.lightColor[0] = glm::vec4(1.0f);
+    frame.lightCount = lightCount;
+    UniformBuffers::BeginFrame(frame);
+}
+
+// Mean milliseconds per frame over frames runs, each finished with glFinish
+static double timeFrames(int frames, const std::function<void()>& drawFrame) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawFrame();
+        glFinish();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+int main(int argc, char** argv) {
+    const char* objPath = argc > 2 ? argv[1] : "assets/woman1.obj";
+    const char* mtlPath = argc > 2 ? argv[2] : "assets/woman1.mtl";
+
+    if (!glfwInit()) {
+        std::fprintf(stderr, "Failed to initialize GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(800, 600, "CrowdBench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "Failed to create GLFW window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (glewInit() != GLEW_OK) {
+        std::fprintf(stderr, "Failed to initialize GLEW\n");
+        return 1;
+    }
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    int result = 0;
+    {
+        ShaderVariants shaders("../src/shaders/vertex_shader.glsl", "../src/shaders/fragment_shader.glsl");
+        shaders.request(ShaderVariants::Key(ShaderTextured | ShaderSpecular | ShaderInstanced, lightCount)).wait();
+        shaders.request(ShaderVariants::Key(ShaderTextured | ShaderSpecular, lightCount)).wait();
+        Model model(objPath, mtlPath);
+        while (!model.Upload(1000.0)) {}
+
+        const glm::mat4 modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f));
+        RenderQueue queue;
+        InstanceBuffer instances;
+        std::vector<glm::mat4> transforms;
+        std::vector<glm::vec3> tints;
+
+        // Let the per-material variants both paths ask for finish compiling first
+        makeCrowd(100, transforms, tints);
+        instances.update(transforms.data(), tints.data(), transforms.size());
+        timeFrames(60, [&] {
+            beginFrame(transforms.size());
+            model.DrawInstanced(queue, shaders, modelMatrix, instances);
+            model.Draw(queue, shaders, modelMatrix);
+            queue.flush(1000.0f);
+        });
+
+        std::printf("instances   instanced ms  draws   per-object ms   draws\n");
+        for (size_t count : { size_t(1), size_t(100), size_t(10000), size_t(100000) }) {
+            makeCrowd(count, transforms, tints);
+            instances.update(transforms.data(), tints.data(), count);
+
+            const double instancedMs = timeFrames(50, [&] {
+                beginFrame(count);
+                model.DrawInstanced(queue, shaders, modelMatrix, instances);
+                queue.flush(1000.0f);
+            });
+            const size_t instancedDraws = queue.getStats().draws;
+
+            if (count <= 10000) {
+                const double perObjectMs = timeFrames(count >= 10000 ? 5 : 50, [&] {
+                    beginFrame(count);
+                    for (size_t i = 0; i < count; ++i) model.Draw(queue, shaders, transforms[i] * modelMatrix);
+                    queue.flush(1000.0f);
+                });
+                std::printf("%9zu  %13.2f  %5zu  %14.2f  %6zu\n", count, instancedMs, instancedDraws, perObjectMs, queue.getStats().draws);
+            } else {
+                std::printf("%9zu  %13.2f  %5zu  %14s  %6s\n", count, instancedMs, instancedDraws, "-", "-");
+            }
+        }
+        if (glGetError() != GL_NO_ERROR) result = 1;
+    }
+
+    GeometryArena::Shutdown();
+    UniformBuffers::Shutdown();
+    glfwTerminate();
+    return result;
+}
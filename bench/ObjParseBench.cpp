@@ -0,0 +1,155 @@
+// ObjParseBench.cpp
+// Compares OBJ parse throughput (MB/s) of the old stream-based loader against ObjParser.
+// Usage: ObjParseBench [file.obj]   (without a file a synthetic grid mesh is generated)
+#include "ObjParser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Output of the old loader: array-of-structs faces with a material string each
+struct LegacyFace {
+    int vertexIndices[3];
+    int texCoordIndices[3];
+    int normalIndices[3];
+    std::string materialName;
+};
+
+struct LegacyObjData {
+    std::vector<Vertex> vertices;
+    std::vector<TexCoord> texCoords;
+    std::vector<Normal> normals;
+    std::vector<LegacyFace> faces;
+};
+
+// The loader as it was before ObjParser: one istringstream per line and
+// a std::replace plus a second istringstream per face corner.
+static void parseStream(const std::string& text, LegacyObjData& out) {
+    std::istringstream file(text);
+    std::string line, currentMaterial;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string type;
+        iss >> type;
+
+        if (type == "v") {
+            Vertex v;
+            iss >> v.x >> v.y >> v.z;
+            out.vertices.push_back(v);
+        }
+        else if (type == "vt") {
+            TexCoord vt;
+            iss >> vt.u >> vt.v;
+            out.texCoords.push_back(vt);
+        }
+        else if (type == "vn") {
+            Normal vn;
+            iss >> vn.x >> vn.y >> vn.z;
+            out.normals.push_back(vn);
+        }
+        else if (type == "usemtl") {
+            iss >> currentMaterial;
+        }
+        else if (type == "f") {
+            LegacyFace face;
+            for (int i = 0; i < 3; ++i) {
+                std::string vertexData;
+                iss >> vertexData;
+                std::replace(vertexData.begin(), vertexData.end(), '/', ' ');
+                std::istringstream vStream(vertexData);
+
+                int v, vt, vn;
+                vStream >> v >> vt >> vn;
+                face.vertexIndices[i] = v - 1;
+                face.texCoordIndices[i] = vt - 1;
+                face.normalIndices[i] = vn - 1;
+            }
+            face.materialName = currentMaterial;
+            out.faces.push_back(face);
+        }
+    }
+}
+
+// Builds an N x N grid with positions, UVs and normals, split over two materials
+static std::string makeGrid(int n) {
+    std::string text;
+    char line[128];
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            float fx = static_cast<float>(x) / n, fy = static_cast<float>(y) / n;
+            text.append(line, std::snprintf(line, sizeof(line), "v %f %f %f\n", fx * 10.0f - 5.0f, fy * 10.0f - 5.0f, 0.25f * fx * fy));
+            text.append(line, std::snprintf(line, sizeof(line), "vt %f %f\n", fx, fy));
+            text.append(line, std::snprintf(line, sizeof(line), "vn %f %f %f\n", 0.0f, 0.0f, 1.0f));
+        }
+    }
+    for (int y = 0; y < n; ++y) {
+        if (y == 0 || y == n / 2) text += (y == 0) ? "usemtl Material__11\n" : "usemtl Material__12\n";
+        for (int x = 0; x < n; ++x) {
+            int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            text.append(line, std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d));
+            text.append(line, std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c));
+        }
+    }
+    return text;
+}
+
+// Best-of-N wall time in seconds
+static double timeBest(int runs, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    std::string text;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open " << argv[1] << std::endl;
+            return 1;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        text = ss.str();
+    } else {
+        text = makeGrid(700);  // ~1M triangles
+    }
+    const double megabytes = text.size() / (1024.0 * 1024.0);
+
+    size_t streamFaces = 0, scannerFaces = 0, parallelFaces = 0;
+    double streamTime = timeBest(3, [&] {
+        LegacyObjData data;
+        parseStream(text, data);
+        streamFaces = data.faces.size();
+    });
+    double scannerTime = timeBest(3, [&] {
+        ObjData data;
+        ObjParser::ParseOBJ(text.data(), text.size(), data, 1);
+        scannerFaces = data.faceCount();
+    });
+    double parallelTime = timeBest(3, [&] {
+        ObjData data;
+        ObjParser::ParseOBJ(text.data(), text.size(), data);
+        parallelFaces = data.faceCount();
+    });
+
+    std::printf("input:   %.1f MB\n", megabytes);
+    std::printf("stream:  %8.1f MB/s  (%.3f s, %zu faces)\n", megabytes / streamTime, streamTime, streamFaces);
+    std::printf("scanner: %8.1f MB/s  (%.3f s, %zu faces)\n", megabytes / scannerTime, scannerTime, scannerFaces);
+    std::printf("threads: %8.1f MB/s  (%.3f s, %zu faces, %u hardware threads)\n", megabytes / parallelTime, parallelTime, parallelFaces,
+                std::thread::hardware_concurrency());
+    std::printf("speedup: %.1fx single-threaded, %.1fx threaded\n", streamTime / scannerTime, streamTime / parallelTime);
+    return streamFaces == scannerFaces && scannerFaces == parallelFaces ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+// OcclusionBench.cpp
+// Checks that OcclusionCuller never hides a box that can be seen. A comb
+// (a bar with a row of teeth, so boxes behind it show through the gaps) is
+// simplified into the same LOD chain Model builds, then rasterized at several
+// distances; every isVisible answer is compared against rays cast through each
+// buffer pixel centre the box covers, tested against the full-detail comb.
+// Levels are picked by the projected-error rule of Model::DrawOccluder; the
+// coarsest level is reported alongside to show what that rule guards against.
+// Usage: OcclusionBench
+#include "OcclusionCuller.h"
+#include "MeshSimplifier.h"
+#include "TriangleBvh.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+static constexpr float VoxelSize = 0.25f;
+
+static bool combSolid(int x, int y, int z, int sizeX, int sizeY, int sizeZ) {
+    if (x < 0 || y < 0 || z < 0 || x >= sizeX || y >= sizeY || z >= sizeZ) return false;
+    return y < 12 || x % 4 < 2;  // a solid bar, then teeth two voxels wide with two-voxel gaps
+}
+
+// Closed surface of the comb's voxels, with shared corners welded
+static void makeComb(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+    const int sizeX = 50, sizeY = 20, sizeZ = 2;
+    const int cornersX = sizeX + 1, cornersY = sizeY + 1;
+    std::vector<uint32_t> corner(static_cast<size_t>(cornersX) * cornersY * (sizeZ + 1), UINT32_MAX);
+    auto vertex = [&](int x, int y, int z) {
+        uint32_t& slot = corner[(static_cast<size_t>(z) * cornersY + y) * cornersX + x];
+        if (slot == UINT32_MAX) {
+            slot = static_cast<uint32_t>(positions.size());
+            positions.emplace_back(x * VoxelSize, y * VoxelSize, z * VoxelSize);
+        }
+        return slot;
+    };
+    // Each of the six face directions: the neighbour offset and the face's four corners, counter-clockwise from outside
+    static const int faces[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    static const int quads[6][4][3] = {
+        { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } }, { { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 }, { 1, 0, 1 } },
+        { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } }, { { 0, 1, 0 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 } },
+        { { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 } }, { { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } },
+    };
+    for (int z = 0; z < sizeZ; ++z) {
+        for (int y = 0; y < sizeY; ++y) {
+            for (int x = 0; x < sizeX; ++x) {
+                if (!combSolid(x, y, z, sizeX, sizeY, sizeZ)) continue;
+                for (int f = 0; f < 6; ++f) {
+                    if (combSolid(x + faces[f][0], y + faces[f][1], z + faces[f][2], sizeX, sizeY, sizeZ)) continue;
+                    uint32_t v[4];
+                    for (int c = 0; c < 4; ++c) v[c] = vertex(x + quads[f][c][0], y + quads[f][c][1], z + quads[f][c][2]);
+                    indices.insert(indices.end(), { v[0], v[1], v[2], v[0], v[2], v[3] });
+                }
+            }
+        }
+    }
+}
+
+// As Model::generateLods: each level halves the previous one and errors add up
+static std::vector<LodLevel> makeLods(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, int lodCount) {
+    std::vector<float> data(positions.size() * 8, 0.0f);  // position, then zero uv and normal
+    for (size_t v = 0; v < positions.size(); ++v) {
+        data[v * 8] = positions[v].x;
+        data[v * 8 + 1] = positions[v].y;
+        data[v * 8 + 2] = positions[v].z;
+    }
+    std::vector<LodLevel> lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+    std::vector<uint32_t> previous(indices), simplified(indices.size());
+    for (int level = 1; level <= lodCount; ++level) {
+        float error = 0.0f;
+        const size_t count = MeshSimplifier::Simplify(simplified.data(), previous.data(), previous.size(), data.data(), 8,
+                                                      positions.size(), previous.size() / 6 * 3, error);
+        if (count == 0 || count > previous.size() * 9 / 10) break;
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(count), lods.back().error + error });
+        indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+        previous.assign(simplified.begin(), simplified.begin() + count);
+    }
+    return lods;
+}
+
+// Slab test; infinity for a miss, 0 when the origin is inside
+static float rayBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    float enter = 0.0f, leave = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; ++axis) {
+        const float inverse = 1.0f / direction[axis];
+        float t0 = (boundsMin[axis] - origin[axis]) * inverse, t1 = (boundsMax[axis] - origin[axis]) * inverse;
+        if (t0 > t1) std::swap(t0, t1);
+        enter = std::max(enter, t0);
+        leave = std::min(leave, t1);
+    }
+    return enter <= leave ? enter : std::numeric_limits<float>::infinity();
+}
+
+struct Box {
+    glm::vec3 boundsMin, boundsMax;
+};
+
+int main() {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    makeComb(positions, indices);
+    const std::vector<LodLevel> lods = makeLods(positions, indices, 6);
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+    for (const glm::vec3& p : positions) {
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    const float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+    TriangleBvh reference;
+    reference.build(positions, std::vector<uint32_t>(indices.begin(), indices.begin() + lods[0].indexCount));
+
+    // Boxes of assorted sizes behind the comb, spread a little wider than it
+    const int boxCount = 3000;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Box> boxes(boxCount);
+    for (Box& box : boxes) {
+        const glm::vec3 p(boundsMin.x - 1.0f + unit(rng) * (boundsMax.x - boundsMin.x + 2.0f),
+                          boundsMin.y - 0.5f + unit(rng) * (boundsMax.y - boundsMin.y + 1.0f), boundsMin.z - 0.5f - unit(rng) * 4.0f);
+        const glm::vec3 size = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.3f + 0.02f;
+        box = { p, p + size };
+    }
+
+    const float nearPlane = 0.1f, fov = glm::radians(45.0f);
+    const float aspect = static_cast<float>(OcclusionCuller::Width) / OcclusionCuller::Height;
+    const glm::mat4 projection = glm::perspective(fov, aspect, nearPlane, 100.0f);
+    const glm::mat4 identity(1.0f);
+    OcclusionCuller culler;
+
+    std::printf("comb: %zu vertices, LODs:", positions.size());
+    for (const LodLevel& lod : lods) std::printf(" %u tris (error %.3f)", lod.indexCount / 3, lod.error);
+    std::printf("\n");
+
+    int failures = 0;
+    for (float cameraDistance : { 8.0f, 16.0f, 32.0f, 64.0f }) {
+        // The camera looks down -z at the comb, so pixel rays need no rotation
+        const glm::vec3 eye = center + glm::vec3(0.0f, 0.0f, cameraDistance);
+        const glm::mat4 viewProjection = projection * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // Exact answer for each box: some pixel centre it covers sees it in front of the comb
+        std::vector<char> visible(boxCount, 0);
+        for (int b = 0; b < boxCount; ++b) {
+            const Box& box = boxes[b];
+            glm::vec2 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+            for (int corner = 0; corner < 8; ++corner) {
+                const glm::vec3 p((corner & 1) ? box.boundsMax.x : box.boundsMin.x, (corner & 2) ? box.boundsMax.y : box.boundsMin.y,
+                                  (corner & 4) ? box.boundsMax.z : box.boundsMin.z);
+                const glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+                const glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(OcclusionCuller::Width, OcclusionCuller::Height);
+                lo = glm::min(lo, screen);
+                hi = glm::max(hi, screen);
+            }
+            const int firstX = std::max(0, static_cast<int>(std::ceil(lo.x - 0.5f))), lastX = std::min(OcclusionCuller::Width - 1, static_cast<int>(std::floor(hi.x - 0.5f)));
+            const int firstY = std::max(0, static_cast<int>(std::ceil(lo.y - 0.5f))), lastY = std::min(OcclusionCuller::Height - 1, static_cast<int>(std::floor(hi.y - 0.5f)));
+            for (int y = firstY; y <= lastY && !visible[b]; ++y) {
+                for (int x = firstX; x <= lastX && !visible[b]; ++x) {
+                    const glm::vec2 ndc((x + 0.5f) / OcclusionCuller::Width * 2.0f - 1.0f, (y + 0.5f) / OcclusionCuller::Height * 2.0f - 1.0f);
+                    const float tanHalf = std::tan(fov * 0.5f);
+                    const glm::vec3 direction = glm::normalize(glm::vec3(ndc.x * aspect * tanHalf, ndc.y * tanHalf, -1.0f));
+                    const float hit = rayBox(eye, direction, box.boundsMin, box.boundsMax);
+                    visible[b] = hit != std::numeric_limits<float>::infinity() && !reference.occluded(eye, direction, hit);
+                }
+            }
+        }
+
+        // Same rule as Model::DrawOccluder
+        const float distance = std::max(glm::length(center - eye) - radius, nearPlane);
+        const float errorToPixels = OcclusionCuller::Height * projection[1][1] * 0.5f / distance;
+        size_t chosen = 0;
+        while (chosen + 1 < lods.size() && lods[chosen + 1].error * errorToPixels <= OcclusionCuller::MaxOccluderPixelError) ++chosen;
+
+        std::printf("camera at %.0f, %d boxes visible:\n", cameraDistance, static_cast<int>(std::count(visible.begin(), visible.end(), 1)));
+        for (size_t level = 0; level < lods.size(); ++level) {
+            culler.beginFrame(viewProjection, nearPlane);
+            culler.addOccluder(positions.data(), positions.size(), indices.data() + lods[level].indexOffset, lods[level].indexCount, identity);
+            const auto start = std::chrono::steady_clock::now();
+            culler.rasterize();
+            int falseCulls = 0;
+            for (int b = 0; b < boxCount; ++b) {
+                if (!culler.isVisible(boxes[b].boundsMin, boxes[b].boundsMax, identity) && visible[b]) ++falseCulls;
+            }
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("  %c level %zu: %5u tris, error %6.2f px, %4zu culled, %3d wrongly, %.2f ms\n", level == chosen ? '*' : ' ', level,
+                        lods[level].indexCount / 3, lods[level].error * errorToPixels, culler.getStats().culled, falseCulls, elapsed.count());
+            if (falseCulls > 0 && level <= chosen) ++failures;
+        }
+    }
+    std::printf("* the level Model::DrawOccluder picks; levels up to it must not cull a visible box\n");
+    return failures == 0 ? 0 : 1;
+}
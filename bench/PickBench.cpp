@@ -0,0 +1,113 @@
+// PickBench.cpp
+// Build time, memory and per-ray cost of TriangleBvh picks, checked against a
+// brute-force pass over every triangle for the first rays.
+// Usage: PickBench [file.obj]   (without a file a 2M-triangle height field is generated)
+#include "TriangleBvh.h"
+#include "ObjParser.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// N x N quads of a bumpy height field over [-5, 5]^2
+static void makeHeightField(int n, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            const float fx = static_cast<float>(x) / n, fy = static_cast<float>(y) / n;
+            positions.emplace_back(fx * 10.0f - 5.0f, fy * 10.0f - 5.0f, 0.3f * std::sin(fx * 40.0f) * std::cos(fy * 35.0f));
+        }
+    }
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            const uint32_t a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+            indices.insert(indices.end(), { a, b, d, a, d, c });
+        }
+    }
+}
+
+// Moller-Trumbore, two-sided; infinity for a miss
+static float rayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    const glm::vec3 e1 = b - a, e2 = c - a, p = glm::cross(direction, e2);
+    const float det = glm::dot(e1, p);
+    if (det == 0.0f) return std::numeric_limits<float>::infinity();
+    const glm::vec3 s = origin - a, q = glm::cross(s, e1);
+    const float u = glm::dot(s, p) / det, v = glm::dot(direction, q) / det, t = glm::dot(e2, q) / det;
+    return (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f) ? t : std::numeric_limits<float>::infinity();
+}
+
+int main(int argc, char** argv) {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open " << argv[1] << std::endl;
+            return 1;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        const std::string text = ss.str();
+        ObjData data;
+        ObjParser::ParseOBJ(text.data(), text.size(), data);
+        for (const Vertex& v : data.vertices) positions.emplace_back(v.x, v.y, v.z);
+        indices.assign(data.faceVertices.begin(), data.faceVertices.end());
+    } else {
+        makeHeightField(1000, positions, indices);
+    }
+    const std::vector<glm::vec3> reference = positions;  // build() takes its own copy
+    glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+    for (const glm::vec3& p : positions) {
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    TriangleBvh bvh;
+    auto start = std::chrono::steady_clock::now();
+    bvh.build(std::move(positions), indices);
+    std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+    // Rays from points on a sphere around the mesh towards random points inside its bounds
+    const int rayCount = 10000, checkedRays = 20;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    const float radius = glm::length(boundsMax - boundsMin);
+    double totalMs = 0.0, worstMs = 0.0;
+    int hits = 0, mismatches = 0;
+    for (int r = 0; r < rayCount; ++r) {
+        const glm::vec3 outward = glm::normalize(glm::vec3(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f));
+        const glm::vec3 origin = center + outward * radius;
+        const glm::vec3 target = boundsMin + (boundsMax - boundsMin) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        const glm::vec3 direction = glm::normalize(target - origin);
+
+        TriangleBvh::Hit hit;
+        start = std::chrono::steady_clock::now();
+        const bool found = bvh.intersect(origin, direction, 2.0f * radius, hit);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+        hits += found;
+
+        if (r < checkedRays) {
+            float closest = std::numeric_limits<float>::infinity();
+            for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                closest = std::min(closest, rayTriangle(origin, direction, reference[indices[t]], reference[indices[t + 1]], reference[indices[t + 2]]));
+            }
+            const bool expected = closest <= 2.0f * radius;
+            if (found != expected || (found && std::fabs(hit.distance - closest) > 1e-4f * radius)) ++mismatches;
+        }
+    }
+
+    std::printf("triangles: %zu\n", bvh.triangleCount());
+    std::printf("build:     %.1f ms, %.1f MB\n", buildTime.count(), bvh.memoryBytes() / (1024.0 * 1024.0));
+    std::printf("pick:      %.4f ms mean, %.4f ms worst over %d rays (%d hits)\n", totalMs / rayCount, worstMs, rayCount, hits);
+    if (mismatches > 0) std::printf("%d of %d checked rays differ from brute force\n", mismatches, checkedRays);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+// VertexAssemblyBench.cpp
+// Compares peak heap use and wall time of the append-based vertex assembly that
+// Model::processVertexData used before MeshBuilder against MeshBuilder::Assemble.
+// Usage: VertexAssemblyBench [file.obj]   (without a file a synthetic grid mesh is generated)
+#include "MeshBuilder.h"
+#include "ObjParser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Heap accounting: every allocation carries its size in a 16-byte header
+static std::atomic<size_t> liveBytes{ 0 }, peakBytes{ 0 };
+
+void* operator new(size_t size) {
+    void* block = std::malloc(size + 16);
+    if (!block) throw std::bad_alloc();
+    *static_cast<size_t*>(block) = size;
+    const size_t live = liveBytes += size;
+    size_t peak = peakBytes;
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+    return static_cast<char*>(block) + 16;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    void* block = static_cast<char*>(p) - 16;
+    liveBytes -= *static_cast<size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+struct CornerKey {
+    int v, vt, vn;
+    bool operator==(const CornerKey& o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+};
+
+struct CornerKeyHash {
+    size_t operator()(const CornerKey& k) const {
+        uint64_t h = static_cast<uint32_t>(k.v) * 0x9e3779b97f4a7c15ULL;
+        h ^= static_cast<uint32_t>(k.vt) * 0xc2b2ae3d27d4eb4fULL + (h << 6) + (h >> 2);
+        h ^= static_cast<uint32_t>(k.vn) * 0x165667b19e3779f9ULL + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+// The assembly as it was: one pass that appends every new vertex with insert()
+// and every index with push_back(), growing both streams as it goes
+static void assembleAppend(const ObjData& obj, std::vector<std::vector<float>>& vertexData,
+                           std::vector<std::vector<uint32_t>>& indexData) {
+    const size_t materialCount = obj.materialNames.size();
+    vertexData.assign(materialCount, {});
+    indexData.assign(materialCount, {});
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> lookup;
+    for (size_t id = 0; id < materialCount; ++id) {
+        std::vector<float>& vertices = vertexData[id];
+        std::vector<uint32_t>& indices = indexData[id];
+        lookup.clear();
+        for (size_t c = obj.materialFaceStart[id] * 3; c < obj.materialFaceStart[id + 1] * 3; ++c) {
+            const CornerKey key{ obj.faceVertices[c], obj.faceTexCoords[c], obj.faceNormals[c] };
+            auto [it, inserted] = lookup.try_emplace(key, static_cast<uint32_t>(vertices.size() / 8));
+            if (inserted) {
+                const Vertex& v = obj.vertices[key.v];
+                const TexCoord t = key.vt >= 0 ? obj.texCoords[key.vt] : TexCoord{ 0.0f, 0.0f };
+                const Normal n = key.vn >= 0 ? obj.normals[key.vn] : Normal{ 0.0f, 0.0f, 0.0f };
+                vertices.insert(vertices.end(), { v.x, v.y, v.z, t.u, t.v, n.x, n.y, n.z });
+            }
+            indices.push_back(it->second);
+        }
+    }
+}
+
+// Builds an N x N grid split over four materials, with one vertex per grid point
+static std::string makeGrid(int n) {
+    std::string text;
+    char line[128];
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            float fx = static_cast<float>(x) / n, fy = static_cast<float>(y) / n;
+            text.append(line, std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0 0 1\n", fx, fy, 0.25f * fx * fy, fx, fy));
+        }
+    }
+    for (int y = 0; y < n; ++y) {
+        if (y % (n / 4) == 0) text.append(line, std::snprintf(line, sizeof(line), "usemtl grid%d\n", y / (n / 4)));
+        for (int x = 0; x < n; ++x) {
+            int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            text.append(line, std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d));
+            text.append(line, std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c));
+        }
+    }
+    return text;
+}
+
+struct Result {
+    double seconds;
+    size_t peakBytes;   // above the parsed input
+    size_t vertexCount;
+};
+
+// Best-of-N wall time; the peak is measured on the first run
+static Result run(int runs, const ObjData& obj,
+                  const std::function<void(const ObjData&, std::vector<std::vector<float>>&, std::vector<std::vector<uint32_t>>&)>& assemble) {
+    Result result{ 1e30, 0, 0 };
+    for (int i = 0; i < runs; ++i) {
+        std::vector<std::vector<float>> vertexData;
+        std::vector<std::vector<uint32_t>> indexData;
+        const size_t baseline = liveBytes;
+        peakBytes = baseline;
+        auto start = std::chrono::steady_clock::now();
+        assemble(obj, vertexData, indexData);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds = std::min(result.seconds, elapsed.count());
+        if (i == 0) result.peakBytes = peakBytes - baseline;
+        result.vertexCount = 0;
+        for (const std::vector<float>& v : vertexData) result.vertexCount += v.size() / 8;
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string text;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open " << argv[1] << std::endl;
+            return 1;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        text = ss.str();
+    } else {
+        text = makeGrid(1000);  // 2M triangles
+    }
+    ObjData obj;
+    ObjParser::ParseOBJ(text.data(), text.size(), obj);
+    std::string().swap(text);
+
+    const Result append = run(3, obj, assembleAppend);
+    const Result twoPass = run(3, obj, MeshBuilder::Assemble);
+
+    std::printf("input:    %zu faces, %zu materials\n", obj.faceCount(), obj.materialNames.size());
+    std::printf("append:   %8.1f ms, peak %8.1f MB  (%zu vertices)\n", append.seconds * 1e3, append.peakBytes / 1048576.0, append.vertexCount);
+    std::printf("two-pass: %8.1f ms, peak %8.1f MB  (%zu vertices)\n", twoPass.seconds * 1e3, twoPass.peakBytes / 1048576.0, twoPass.vertexCount);
+    std::printf("speedup:  %.2fx, peak memory %.2fx\n", append.seconds / twoPass.seconds,
+                static_cast<double>(append.peakBytes) / std::max<size_t>(twoPass.peakBytes, 1));
+    return append.vertexCount == twoPass.vertexCount ? 0 : 1;
+}
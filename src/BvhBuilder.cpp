@@ -0,0 +1,140 @@
+#include "BvhBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int BinCount = 16;
+constexpr float TraversalCost = 1.0f;  // relative to testing one item
+
+struct Bin {
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+    uint32_t count = 0;
+    void grow(const glm::vec3& lo, const glm::vec3& hi) {
+        min = glm::min(min, lo);
+        max = glm::max(max, hi);
+    }
+};
+
+// Boxes are partitioned by value rather than through an index, so every pass
+// over a node reads one contiguous run
+struct Reference {
+    glm::vec3 min;
+    uint32_t id;
+    glm::vec3 max;
+    uint32_t padding;
+    glm::vec3 centroid() const { return (min + max) * 0.5f; }
+};
+
+} // namespace
+
+float BvhBuilder::Area(const glm::vec3& min, const glm::vec3& max) {
+    const glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+glm::vec3 BvhBuilder::InverseDirection(const glm::vec3& direction) {
+    glm::vec3 inverse;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = direction[axis];
+        inverse[axis] = 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+    }
+    return inverse;
+}
+
+void BvhBuilder::Build(const glm::vec3* boxMin, const glm::vec3* boxMax, size_t count, uint32_t maxLeafItems,
+                       std::vector<BvhNode>& nodes, std::vector<uint32_t>& items) {
+    const uint32_t n = static_cast<uint32_t>(count);
+    nodes.clear();
+    items.resize(n);
+    if (n == 0) return;
+    std::vector<Reference> references(n);
+    for (uint32_t i = 0; i < n; ++i) references[i] = { boxMin[i], i, boxMax[i], 0 };
+
+    // Explicit stack; every split appends both children together
+    struct Task { uint32_t node, first, count; int depth; };
+    std::vector<Task> tasks{ { 0, 0, n, 0 } };
+    nodes.reserve(2 * static_cast<size_t>(n));
+    nodes.push_back({});
+    while (!tasks.empty()) {
+        const Task task = tasks.back();
+        tasks.pop_back();
+
+        Bin nodeBounds, centroidBounds;
+        for (uint32_t i = task.first; i < task.first + task.count; ++i) {
+            const Reference& r = references[i];
+            nodeBounds.grow(r.min, r.max);
+            centroidBounds.grow(r.centroid(), r.centroid());
+        }
+        nodes[task.node] = { nodeBounds.min, task.first, nodeBounds.max, task.count };
+        if (task.count <= 2 || task.depth >= MaxDepth - 2) continue;
+
+        // Bins along each axis of the centroid bounds; the split between two
+        // bins is scored by count * area of either side
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 0.0f) continue;
+            Bin bins[BinCount];
+            const float scale = BinCount / extent[axis];
+            for (uint32_t i = task.first; i < task.first + task.count; ++i) {
+                const Reference& r = references[i];
+                const int b = std::min(BinCount - 1, static_cast<int>((r.centroid()[axis] - centroidBounds.min[axis]) * scale));
+                bins[b].grow(r.min, r.max);
+                ++bins[b].count;
+            }
+            float rightArea[BinCount];
+            uint32_t rightCount[BinCount];
+            Bin right;
+            uint32_t sideCount = 0;
+            for (int b = BinCount - 1; b > 0; --b) {
+                right.grow(bins[b].min, bins[b].max);
+                sideCount += bins[b].count;
+                rightArea[b] = Area(right.min, right.max);
+                rightCount[b] = sideCount;
+            }
+            Bin left;
+            sideCount = 0;
+            for (int b = 0; b < BinCount - 1; ++b) {
+                left.grow(bins[b].min, bins[b].max);
+                sideCount += bins[b].count;
+                if (sideCount == 0 || rightCount[b + 1] == 0) continue;
+                const float splitCost = sideCount * Area(left.min, left.max) + rightCount[b + 1] * rightArea[b + 1];
+                if (splitCost < bestCost) {
+                    bestCost = splitCost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+
+        uint32_t middle;
+        if (bestAxis >= 0) {
+            // Keep small nodes as leaves when splitting them does not pay
+            const float nodeArea = Area(nodeBounds.min, nodeBounds.max);
+            if (task.count <= maxLeafItems && TraversalCost * nodeArea + bestCost >= task.count * nodeArea) continue;
+            const float origin = centroidBounds.min[bestAxis], scale = BinCount / extent[bestAxis];
+            Reference* split = std::partition(references.data() + task.first, references.data() + task.first + task.count, [&](const Reference& r) {
+                return std::min(BinCount - 1, static_cast<int>((r.centroid()[bestAxis] - origin) * scale)) < bestSplit;
+            });
+            middle = static_cast<uint32_t>(split - references.data());
+        } else {
+            // All centroids coincide: SAH cannot separate them, halve by count
+            if (task.count <= maxLeafItems) continue;
+            middle = task.first + task.count / 2;
+        }
+
+        const uint32_t children = static_cast<uint32_t>(nodes.size());
+        nodes[task.node].first = children;
+        nodes[task.node].count = 0;
+        nodes.push_back({});
+        nodes.push_back({});
+        tasks.push_back({ children, task.first, middle - task.first, task.depth + 1 });
+        tasks.push_back({ children + 1, middle, task.first + task.count - middle, task.depth + 1 });
+    }
+    nodes.shrink_to_fit();
+    for (uint32_t i = 0; i < n; ++i) items[i] = references[i].id;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef BVHBUILDER_H
+#define BVHBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// 32 bytes: interior nodes have count 0 and children at first and first + 1,
+// leaves hold items [first, first + count) of the builder's item order
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+
+// Top-down binned SAH construction shared by InstanceBvh and TriangleBvh
+class BvhBuilder {
+public:
+    // Deepest node Build creates; traversal stacks of this size never overflow
+    static constexpr int MaxDepth = 64;
+
+    // Builds nodes over count boxes. items receives the box indices in leaf
+    // order. Nodes of up to maxLeafItems boxes become leaves when the SAH
+    // says splitting them does not pay; larger ones are always split, except
+    // when their centroids coincide or MaxDepth is reached.
+    static void Build(const glm::vec3* boxMin, const glm::vec3* boxMax, size_t count, uint32_t maxLeafItems,
+                      std::vector<BvhNode>& nodes, std::vector<uint32_t>& items);
+
+    static float Area(const glm::vec3& min, const glm::vec3& max);
+    // 1 / direction for slab tests, with zero components replaced by a tiny
+    // value of the same sign, so an origin on a box face never yields 0 * inf
+    static glm::vec3 InverseDirection(const glm::vec3& direction);
+};
+
+#endif
\ No newline at end of file
@@ -10,15 +10,22 @@ Camera::Camera(glm::vec3 position)
       MovementSpeed(5.0f),
       MouseSensitivity(0.01f),
       Yaw(-90.0f),
-      Pitch(0.0f) {
+      Pitch(0.0f),
+      Zoom(45.0f),
+      NearPlane(0.1f),
+      FarPlane(100.0f) {
     Position = position;
     updateCameraVectors();
 }
 
-glm::mat4 Camera::GetViewMatrix() {
+glm::mat4 Camera::GetViewMatrix() const {
     return glm::lookAt(Position, Position + Front, Up);
 }
 
+glm::mat4 Camera::GetProjectionMatrix(float aspect) const {
+    return glm::perspective(glm::radians(Zoom), aspect, NearPlane, FarPlane);
+}
+
 void Camera::ProcessKeyboard(int key, float deltaTime) {
     float velocity = MovementSpeed * deltaTime;
     if (key == GLFW_KEY_W) Position += Front * velocity;
@@ -50,6 +57,33 @@ void Camera::updateCameraVectors() {
     Up = glm::normalize(glm::cross(Right, Front));
 }
 
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[0] = row3 + row0;
+    f.planes[1] = row3 - row0;
+    f.planes[2] = row3 + row1;
+    f.planes[3] = row3 - row1;
+    f.planes[4] = row3 + row2;
+    f.planes[5] = row3 - row2;
+    for (glm::vec4& p : f.planes) {
+        p = p / glm::length(glm::vec3(p));
+    }
+    return f;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& p : planes) {
+        if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+    }
+    return true;
+}
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     static bool firstMouse = true;
     static float lastX = 400, lastY = 300;
@@ -5,6 +5,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+// Six normalized clip planes (left, right, bottom, top, near, far) stored as
+// (normal, distance); a point p is inside when dot(normal, p) + distance >= 0
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Planes live in whatever space the matrix maps from, e.g. pass
+    // projection * view * model to get model-space planes
+    static Frustum FromMatrix(const glm::mat4& m);
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
+
 class Camera {
 public:
     glm::vec3 Position;
@@ -17,9 +28,13 @@ public:
     float MouseSensitivity;
     float Yaw;
     float Pitch;
+    float Zoom;       // vertical field of view in degrees
+    float NearPlane;
+    float FarPlane;
 
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 15.0f));
-    glm::mat4 GetViewMatrix();
+    glm::mat4 GetViewMatrix() const;
+    glm::mat4 GetProjectionMatrix(float aspect) const;
     void ProcessKeyboard(int key, float deltaTime);
     void ProcessMouseMovement(float xoffset, float yoffset);
 
@@ -0,0 +1,156 @@
+#include "FrustumCulling.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define CULL_SSE 1
+// AVX2 is compiled per function and picked at run time where the compiler
+// allows it; otherwise only when the whole build targets it
+#if defined(__GNUC__)
+#define CULL_AVX2 1
+#define CULL_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define CULL_AVX2 1
+#define CULL_AVX2_TARGET
+#endif
+#endif
+
+void AabbList::resize(size_t count) {
+    for (std::vector<float>* v : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) v->resize(count);
+}
+
+void AabbList::set(size_t i, const glm::vec3& min, const glm::vec3& max) {
+    minX[i] = min.x; minY[i] = min.y; minZ[i] = min.z;
+    maxX[i] = max.x; maxY[i] = max.y; maxZ[i] = max.z;
+}
+
+namespace {
+
+// Per plane, the corner of a box furthest along the plane normal (the
+// "positive vertex"): the box is outside when even that corner is behind.
+// The choice only depends on the normal's signs, so it selects whole arrays.
+struct PlaneSelect {
+    const float* x;
+    const float* y;
+    const float* z;
+    float nx, ny, nz, d;
+};
+
+void selectCorners(const Frustum& frustum, const AabbList& boxes, PlaneSelect (&planes)[6]) {
+    for (int p = 0; p < 6; ++p) {
+        const glm::vec4& plane = frustum.planes[p];
+        planes[p] = { plane.x >= 0.0f ? boxes.maxX.data() : boxes.minX.data(),
+                      plane.y >= 0.0f ? boxes.maxY.data() : boxes.minY.data(),
+                      plane.z >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data(),
+                      plane.x, plane.y, plane.z, plane.w };
+    }
+}
+
+size_t cullScalar(const PlaneSelect (&planes)[6], size_t begin, size_t end, uint32_t* visible, size_t count) {
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (const PlaneSelect& p : planes) {
+            inside &= p.nx * p.x[i] + p.ny * p.y[i] + p.nz * p.z[i] + p.d >= 0.0f;
+        }
+        // Branch-free compaction: always write, only advance past survivors
+        visible[count] = static_cast<uint32_t>(i);
+        count += inside;
+    }
+    return count;
+}
+
+#ifdef CULL_SSE
+size_t cullSSE(const PlaneSelect (&planes)[6], size_t size, uint32_t* visible, size_t& done) {
+    size_t count = 0, i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const PlaneSelect& p : planes) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.nx), _mm_loadu_ps(p.x + i)),
+                                         _mm_mul_ps(_mm_set1_ps(p.ny), _mm_loadu_ps(p.y + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(p.nz), _mm_loadu_ps(p.z + i)));
+            distance = _mm_add_ps(distance, _mm_set1_ps(p.d));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; ++lane) {
+            visible[count] = static_cast<uint32_t>(i + lane);
+            count += (mask >> lane) & 1;
+        }
+    }
+    done = i;
+    return count;
+}
+#endif
+
+#ifdef CULL_AVX2
+CULL_AVX2_TARGET
+size_t cullAVX2(const PlaneSelect (&planes)[6], size_t size, uint32_t* visible, size_t& done) {
+    size_t count = 0, i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const PlaneSelect& p : planes) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.nx), _mm256_loadu_ps(p.x + i)),
+                                            _mm256_mul_ps(_mm256_set1_ps(p.ny), _mm256_loadu_ps(p.y + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(p.nz), _mm256_loadu_ps(p.z + i)));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(p.d));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; ++lane) {
+            visible[count] = static_cast<uint32_t>(i + lane);
+            count += (mask >> lane) & 1;
+        }
+    }
+    done = i;
+    return count;
+}
+#endif
+
+} // namespace
+
+FrustumCuller::Kernel FrustumCuller::Best() {
+#if defined(CULL_AVX2) && defined(__GNUC__)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) return Kernel::AVX2;
+#elif defined(CULL_AVX2)
+    return Kernel::AVX2;
+#endif
+#ifdef CULL_SSE
+    return Kernel::SSE;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+const char* FrustumCuller::Name(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AVX2: return "AVX2";
+    case Kernel::SSE: return "SSE";
+    default: return "scalar";
+    }
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, const AabbList& boxes, uint32_t* visible, Kernel kernel) {
+    PlaneSelect planes[6];
+    selectCorners(frustum, boxes, planes);
+
+    // The vector kernels stop at the last full group of lanes; the rest is scalar
+    size_t count = 0, done = 0;
+#ifdef CULL_AVX2
+    if (kernel == Kernel::AVX2) count = cullAVX2(planes, boxes.size(), visible, done);
+#endif
+#ifdef CULL_SSE
+    if (kernel == Kernel::SSE) count = cullSSE(planes, boxes.size(), visible, done);
+#endif
+    return cullScalar(planes, done, boxes.size(), visible, count);
+}
+
+void FrustumCuller::TransformBounds(const glm::mat4& m, const glm::vec3& min, const glm::vec3& max, glm::vec3& outMin, glm::vec3& outMax) {
+    // Arvo: per output axis, each input axis adds its smaller and larger product
+    outMin = outMax = glm::vec3(m[3]);
+    for (int column = 0; column < 3; ++column) {
+        const glm::vec3 a = glm::vec3(m[column]) * min[column];
+        const glm::vec3 b = glm::vec3(m[column]) * max[column];
+        outMin += glm::min(a, b);
+        outMax += glm::max(a, b);
+    }
+}
\ No newline at end of file
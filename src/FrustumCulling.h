@@ -0,0 +1,38 @@
+#ifndef FRUSTUMCULLING_H
+#define FRUSTUMCULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+
+// Axis-aligned boxes stored as one array per bound component, so the culling
+// kernels load the same component of 4 or 8 boxes at once
+struct AabbList {
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+    size_t size() const { return minX.size(); }
+    void resize(size_t count);
+    void set(size_t i, const glm::vec3& min, const glm::vec3& max);
+};
+
+// Frustum culling of many boxes per call. Cull writes the indices of the boxes
+// that are not entirely outside a plane, in ascending order, to visible, which
+// needs room for boxes.size() entries, and returns how many it wrote. A box
+// crossing the corner of two planes can be kept although it is outside.
+class FrustumCuller {
+public:
+    enum class Kernel { Scalar, SSE, AVX2 };
+
+    // Widest kernel this CPU and build support
+    static Kernel Best();
+    static const char* Name(Kernel kernel);
+
+    static size_t Cull(const Frustum& frustum, const AabbList& boxes, uint32_t* visible, Kernel kernel = Best());
+
+    // Box around the 8 transformed corners of [min, max]
+    static void TransformBounds(const glm::mat4& m, const glm::vec3& min, const glm::vec3& max, glm::vec3& outMin, glm::vec3& outMax);
+};
+
+#endif
\ No newline at end of file
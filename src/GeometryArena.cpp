@@ -0,0 +1,214 @@
+#include "GeometryArena.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct Range {
+    size_t offset, size;
+};
+
+// First-fit allocator over the byte range of one buffer
+class FreeList {
+public:
+    explicit FreeList(size_t capacity) : ranges{ { 0, capacity } } {}
+
+    bool allocate(size_t size, size_t& offset) {
+        for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+            if (it->size < size) continue;
+            offset = it->offset;
+            it->offset += size;
+            it->size -= size;
+            if (it->size == 0) ranges.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    // Returns the range and merges it with free neighbours
+    void release(size_t offset, size_t size) {
+        auto next = std::lower_bound(ranges.begin(), ranges.end(), offset,
+                                     [](const Range& r, size_t o) { return r.offset < o; });
+        auto it = ranges.insert(next, { offset, size });
+        if (it + 1 != ranges.end() && it->offset + it->size == (it + 1)->offset) {
+            it->size += (it + 1)->size;
+            ranges.erase(it + 1);
+        }
+        if (it != ranges.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+            (it - 1)->size += it->size;
+            ranges.erase(it);
+        }
+    }
+
+private:
+    std::vector<Range> ranges;  // sorted by offset
+};
+
+struct Page {
+    GLuint vertexArray, vertexBuffer, indexBuffer;
+    size_t vertexCapacity, indexCapacity;
+    FreeList vertices, indices;
+};
+
+std::vector<Page> pages[2];          // per VertexFormat
+GLuint drawIndexBuffer = 0;          // 0 .. MaxDrawMaterials - 1, read per instance
+GLuint indirectBuffer = 0;
+size_t indirectCapacity = 0;
+GLuint boundVertexArray = 0;
+int multiDrawSupport = -1;           // unknown until the first page is created
+
+bool supportsMultiDraw() {
+    if (multiDrawSupport < 0) {
+        multiDrawSupport = (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance)) ? 1 : 0;
+        if (!multiDrawSupport) std::cerr << "glMultiDrawElementsIndirect unavailable, drawing per command" << std::endl;
+    }
+    return multiDrawSupport == 1;
+}
+
+void bindVertexArray(GLuint vertexArray) {
+    if (vertexArray != boundVertexArray) {
+        glBindVertexArray(vertexArray);
+        boundVertexArray = vertexArray;
+    }
+}
+
+Page& createPage(VertexFormat format, size_t vertexBytes, size_t indexBytes) {
+    const size_t stride = VertexLayout::Stride(format);
+    const size_t vertexCapacity = std::max(GeometryArena::PageBytes, vertexBytes) / stride * stride;
+    const size_t indexCapacity = std::max(GeometryArena::PageBytes, indexBytes);
+    Page page{ 0, 0, 0, vertexCapacity, indexCapacity, FreeList(vertexCapacity), FreeList(indexCapacity) };
+
+    glGenVertexArrays(1, &page.vertexArray);
+    glGenBuffers(1, &page.vertexBuffer);
+    glGenBuffers(1, &page.indexBuffer);
+    bindVertexArray(page.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity, nullptr, GL_STATIC_DRAW);
+    // The element buffer binding is part of the VAO state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+    VertexLayout::SetupAttributes(format);
+
+    // Attribute 3 is the per-draw material index: an instanced attribute
+    // indexed by the command's baseInstance, or a constant set per draw
+    if (supportsMultiDraw()) {
+        if (drawIndexBuffer == 0) {
+            std::vector<uint32_t> identity(GeometryArena::MaxDrawMaterials);
+            for (uint32_t i = 0; i < identity.size(); ++i) identity[i] = i;
+            glGenBuffers(1, &drawIndexBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(uint32_t), identity.data(), GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(3);
+    }
+
+    std::vector<Page>& list = pages[static_cast<size_t>(format)];
+    list.push_back(page);
+    return list.back();
+}
+
+void write(GLuint buffer, size_t offset, size_t size, const void* data) {
+    // The copy-write target leaves the VAO's element binding alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+} // namespace
+
+ArenaAllocation GeometryArena::Allocate(VertexFormat format, size_t vertexCount, size_t indexBytes) {
+    ArenaAllocation allocation;
+    allocation.format = format;
+    allocation.vertexBytes = vertexCount * VertexLayout::Stride(format);
+    allocation.indexBytes = (indexBytes + 3) & ~size_t(3);
+
+    std::vector<Page>& list = pages[static_cast<size_t>(format)];
+    for (uint32_t p = 0; p < list.size(); ++p) {
+        Page& page = list[p];
+        if (!page.vertices.allocate(allocation.vertexBytes, allocation.vertexOffset)) continue;
+        if (!page.indices.allocate(allocation.indexBytes, allocation.indexOffset)) {
+            page.vertices.release(allocation.vertexOffset, allocation.vertexBytes);
+            continue;
+        }
+        allocation.page = p;
+        return allocation;
+    }
+
+    Page& page = createPage(format, allocation.vertexBytes, allocation.indexBytes);
+    page.vertices.allocate(allocation.vertexBytes, allocation.vertexOffset);
+    page.indices.allocate(allocation.indexBytes, allocation.indexOffset);
+    allocation.page = static_cast<uint32_t>(list.size() - 1);
+    return allocation;
+}
+
+void GeometryArena::Free(const ArenaAllocation& allocation) {
+    std::vector<Page>& list = pages[static_cast<size_t>(allocation.format)];
+    if (allocation.page >= list.size()) return;
+    if (allocation.vertexBytes) list[allocation.page].vertices.release(allocation.vertexOffset, allocation.vertexBytes);
+    if (allocation.indexBytes) list[allocation.page].indices.release(allocation.indexOffset, allocation.indexBytes);
+}
+
+void GeometryArena::WriteVertices(const ArenaAllocation& allocation, size_t offset, size_t size, const void* data) {
+    write(pages[static_cast<size_t>(allocation.format)][allocation.page].vertexBuffer, allocation.vertexOffset + offset, size, data);
+}
+
+void GeometryArena::WriteIndices(const ArenaAllocation& allocation, size_t offset, size_t size, const void* data) {
+    write(pages[static_cast<size_t>(allocation.format)][allocation.page].indexBuffer, allocation.indexOffset + offset, size, data);
+}
+
+void GeometryArena::MultiDraw(VertexFormat format, uint32_t page, GLenum indexType, const DrawCommand* commands, size_t count) {
+    if (count == 0) return;
+    bindVertexArray(pages[static_cast<size_t>(format)][page].vertexArray);
+
+    if (supportsMultiDraw()) {
+        // Orphan and refill the shared command buffer
+        const size_t bytes = count * sizeof(DrawCommand);
+        if (indirectBuffer == 0) glGenBuffers(1, &indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        indirectCapacity = std::max(indirectCapacity, bytes);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, nullptr, static_cast<GLsizei>(count), 0);
+        return;
+    }
+
+    const size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+    for (size_t i = 0; i < count; ++i) {
+        const DrawCommand& c = commands[i];
+        const void* offset = reinterpret_cast<void*>(static_cast<uintptr_t>(c.firstIndex) * indexSize);
+        glVertexAttribI4ui(3, c.baseInstance, 0, 0, 0);
+        if (c.instanceCount == 1) {
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(c.count), indexType, offset, c.baseVertex);
+        } else {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(c.count), indexType, offset,
+                                              static_cast<GLsizei>(c.instanceCount), c.baseVertex);
+        }
+    }
+}
+
+size_t GeometryArena::CapacityBytes() {
+    size_t bytes = 0;
+    for (const std::vector<Page>& list : pages) {
+        for (const Page& page : list) bytes += page.vertexCapacity + page.indexCapacity;
+    }
+    return bytes;
+}
+
+void GeometryArena::Shutdown() {
+    for (std::vector<Page>& list : pages) {
+        for (Page& page : list) {
+            glDeleteVertexArrays(1, &page.vertexArray);
+            glDeleteBuffers(1, &page.vertexBuffer);
+            glDeleteBuffers(1, &page.indexBuffer);
+        }
+        list.clear();
+    }
+    glDeleteBuffers(1, &drawIndexBuffer);
+    glDeleteBuffers(1, &indirectBuffer);
+    drawIndexBuffer = indirectBuffer = 0;
+    indirectCapacity = 0;
+    boundVertexArray = 0;
+}
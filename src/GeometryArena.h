@@ -0,0 +1,61 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include "VertexLayout.h"
+
+// Vertex and index ranges sub-allocated from one arena page
+struct ArenaAllocation {
+    VertexFormat format = VertexFormat::Float32;
+    uint32_t page = 0;
+    size_t vertexOffset = 0, vertexBytes = 0;  // bytes into the page's vertex buffer, a multiple of the stride
+    size_t indexOffset = 0, indexBytes = 0;    // bytes into its index buffer, a multiple of 4
+
+    int32_t baseVertex() const { return static_cast<int32_t>(vertexOffset / VertexLayout::Stride(format)); }
+    // First index of the allocation for the given index size
+    uint32_t firstIndex(size_t indexSize) const { return static_cast<uint32_t>(indexOffset / indexSize); }
+};
+
+// Matches GL's DrawElementsIndirectCommand
+struct DrawCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;  // read by the shaders as the per-draw material index (not by instanced variants)
+};
+
+// Shared geometry storage. Each vertex format has a list of pages; a page is a
+// large vertex buffer, a large index buffer and the one VAO that binds both, so
+// everything in a page draws without rebinding. Allocations are first-fit from
+// per-buffer free lists. All calls need the GL context thread.
+class GeometryArena {
+public:
+    // Default size of each page buffer; larger requests get a page of their own
+    static constexpr size_t PageBytes = 32 << 20;
+    // Per-draw material indices run from 0 to MaxDrawMaterials - 1
+    static constexpr uint32_t MaxDrawMaterials = 128;
+
+    static ArenaAllocation Allocate(VertexFormat format, size_t vertexCount, size_t indexBytes);
+    // Safe to call after Shutdown
+    static void Free(const ArenaAllocation& allocation);
+
+    // Copy into the allocation's buffers; offsets are relative to the allocation
+    static void WriteVertices(const ArenaAllocation& allocation, size_t offset, size_t size, const void* data);
+    static void WriteIndices(const ArenaAllocation& allocation, size_t offset, size_t size, const void* data);
+
+    // Draws commands against one page with glMultiDrawElementsIndirect, or one
+    // glDrawElementsBaseVertex per command where that is not supported. The
+    // page's VAO stays bound afterwards and is only rebound when it changes.
+    static void MultiDraw(VertexFormat format, uint32_t page, GLenum indexType, const DrawCommand* commands, size_t count);
+
+    // Bytes of page storage allocated on the GPU
+    static size_t CapacityBytes();
+
+    // Deletes every page; call before the context goes away
+    static void Shutdown();
+};
+
+#endif
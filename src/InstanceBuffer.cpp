@@ -0,0 +1,34 @@
+#include "InstanceBuffer.h"
+#include <algorithm>
+
+InstanceBuffer::~InstanceBuffer() {
+    if (bufferTexture != 0) glDeleteTextures(1, &bufferTexture);
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+}
+
+void InstanceBuffer::update(const glm::mat4* transforms, const glm::vec3* tints, size_t instanceCount) {
+    staging.resize(instanceCount * TexelsPerInstance);
+    for (size_t i = 0; i < instanceCount; ++i) {
+        glm::vec4* texels = &staging[i * TexelsPerInstance];
+        for (int column = 0; column < 4; ++column) texels[column] = transforms[i][column];
+        texels[4] = tints ? glm::vec4(tints[i], 1.0f) : glm::vec4(1.0f);
+    }
+    count = instanceCount;
+
+    const bool created = (buffer == 0);
+    if (created) {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &bufferTexture);
+    }
+    // Orphan on every update so draws still reading the old contents never stall it
+    const size_t bytes = staging.size() * sizeof(glm::vec4);
+    capacity = std::max(capacity, bytes);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    if (bytes > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, staging.data());
+    if (created) {
+        // The texture follows the buffer object through later reallocations
+        glBindTexture(GL_TEXTURE_BUFFER, bufferTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    }
+}
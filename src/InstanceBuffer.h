@@ -0,0 +1,40 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Per-instance transforms and tints for Model::DrawInstanced, stored in a
+// buffer texture the INSTANCED shader variants read with texelFetch at
+// gl_InstanceID. Buffer textures are core in GL 3.1, so this needs neither
+// SSBOs nor extra attributes in the shared arena VAOs.
+// All calls need the GL context thread.
+class InstanceBuffer {
+public:
+    // RGBA32F texels per instance: four model matrix columns, then the tint
+    static constexpr size_t TexelsPerInstance = 5;
+
+    InstanceBuffer() = default;
+    ~InstanceBuffer();
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // Replaces the contents. Transforms may only rotate, translate and scale
+    // uniformly, since normals are transformed without an inverse transpose.
+    // Without tints every instance is untinted (white).
+    void update(const glm::mat4* transforms, const glm::vec3* tints, size_t count);
+
+    size_t size() const { return count; }
+    GLuint texture() const { return bufferTexture; }
+    size_t gpuBytes() const { return capacity; }
+
+private:
+    GLuint buffer = 0, bufferTexture = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    std::vector<glm::vec4> staging;
+};
+
+#endif
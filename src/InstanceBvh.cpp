@@ -0,0 +1,179 @@
+#include "InstanceBvh.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t MaxLeafItems = 8;
+constexpr float TraversalCost = 1.0f;  // as in BvhBuilder
+
+float distanceSquared(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+    const glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+} // namespace
+
+void InstanceBvh::build(const AabbList& bounds) {
+    const size_t n = bounds.size();
+    itemMin.resize(n);
+    itemMax.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        itemMin[i] = glm::vec3(bounds.minX[i], bounds.minY[i], bounds.minZ[i]);
+        itemMax[i] = glm::vec3(bounds.maxX[i], bounds.maxY[i], bounds.maxZ[i]);
+    }
+    BvhBuilder::Build(itemMin.data(), itemMax.data(), n, MaxLeafItems, nodes, items);
+    refit(bounds);
+    builtCost = cost;
+}
+
+void InstanceBvh::refit(const AabbList& bounds) {
+    if (bounds.size() != itemMin.size()) return;  // a different instance set needs build()
+    for (size_t i = 0; i < itemMin.size(); ++i) {
+        itemMin[i] = glm::vec3(bounds.minX[i], bounds.minY[i], bounds.minZ[i]);
+        itemMax[i] = glm::vec3(bounds.maxX[i], bounds.maxY[i], bounds.maxZ[i]);
+    }
+
+    // Children come after their parent, so a reverse walk sees them first
+    float total = 0.0f;
+    for (size_t n = nodes.size(); n-- > 0;) {
+        BvhNode& node = nodes[n];
+        if (node.count > 0) {
+            node.min = glm::vec3(std::numeric_limits<float>::max());
+            node.max = glm::vec3(std::numeric_limits<float>::lowest());
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                node.min = glm::min(node.min, itemMin[items[i]]);
+                node.max = glm::max(node.max, itemMax[items[i]]);
+            }
+            total += node.count * BvhBuilder::Area(node.min, node.max);
+        } else {
+            node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+            node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+            total += TraversalCost * BvhBuilder::Area(node.min, node.max);
+        }
+    }
+    const float rootArea = nodes.empty() ? 0.0f : BvhBuilder::Area(nodes[0].min, nodes[0].max);
+    cost = rootArea > 0.0f ? total / rootArea : 0.0f;
+}
+
+void InstanceBvh::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    if (nodes.empty()) return;
+    // Each entry carries the planes its box still straddles; a node inside
+    // all of them passes its whole subtree without further tests
+    struct Entry { uint32_t node; uint32_t planeMask; };
+    Entry stack[MaxDepth];
+    int top = 0;
+    stack[top++] = { 0, 0x3F };
+    while (top > 0) {
+        const Entry current = stack[--top];
+        const BvhNode& node = nodes[current.node];
+        uint32_t mask = current.planeMask;
+        bool outside = false;
+        for (int p = 0; p < 6 && mask != 0; ++p) {
+            if (!(mask & (1u << p))) continue;
+            const glm::vec4& plane = frustum.planes[p];
+            const glm::vec3 normal(plane);
+            const glm::vec3 positive(normal.x >= 0.0f ? node.max.x : node.min.x,
+                                     normal.y >= 0.0f ? node.max.y : node.min.y,
+                                     normal.z >= 0.0f ? node.max.z : node.min.z);
+            if (glm::dot(normal, positive) + plane.w < 0.0f) {
+                outside = true;
+                break;
+            }
+            const glm::vec3 negative(normal.x >= 0.0f ? node.min.x : node.max.x,
+                                     normal.y >= 0.0f ? node.min.y : node.max.y,
+                                     normal.z >= 0.0f ? node.min.z : node.max.z);
+            if (glm::dot(normal, negative) + plane.w >= 0.0f) mask &= ~(1u << p);
+        }
+        if (outside) continue;
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const uint32_t item = items[i];
+                bool inside = true;
+                for (int p = 0; p < 6 && inside; ++p) {
+                    if (!(mask & (1u << p))) continue;
+                    const glm::vec4& plane = frustum.planes[p];
+                    const glm::vec3 positive(plane.x >= 0.0f ? itemMax[item].x : itemMin[item].x,
+                                             plane.y >= 0.0f ? itemMax[item].y : itemMin[item].y,
+                                             plane.z >= 0.0f ? itemMax[item].z : itemMin[item].z);
+                    inside = glm::dot(glm::vec3(plane), positive) + plane.w >= 0.0f;
+                }
+                if (inside) visible.push_back(item);
+            }
+            continue;
+        }
+        stack[top++] = { node.first + 1, mask };
+        stack[top++] = { node.first, mask };
+    }
+}
+
+float InstanceBvh::rayBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const {
+    // Slab test; infinity for a miss
+    const glm::vec3 t0 = (node.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (node.max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    const float entry = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+    const float exit = std::min({ tFar.x, tFar.y, tFar.z, maxDistance });
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+float InstanceBvh::rayItem(uint32_t item, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const {
+    const BvhNode box{ itemMin[item], 0, itemMax[item], 0 };
+    return rayBox(box, origin, inverseDirection, maxDistance);
+}
+
+uint32_t InstanceBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const {
+    return raycast(origin, direction, maxDistance, distance, [](uint32_t, float entry) { return entry; });
+}
+
+void InstanceBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& found) const {
+    if (nodes.empty()) return;
+    const float radiusSquared = radius * radius;
+    uint32_t stack[MaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode& node = nodes[stack[--top]];
+        if (distanceSquared(center, node.min, node.max) > radiusSquared) continue;
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                if (distanceSquared(center, itemMin[items[i]], itemMax[items[i]]) <= radiusSquared) found.push_back(items[i]);
+            }
+            continue;
+        }
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+    }
+}
+
+uint32_t InstanceBvh::nearest(const glm::vec3& point, float maxDistance, float& distance) const {
+    // Branch and bound: the nearer child first, anything beyond the best so far pruned
+    float best = maxDistance * maxDistance;
+    uint32_t closest = InvalidIndex;
+    struct Entry { uint32_t node; float distanceSquared; };
+    Entry stack[MaxDepth];
+    int top = 0;
+    if (!nodes.empty()) stack[top++] = { 0, distanceSquared(point, nodes[0].min, nodes[0].max) };
+    while (top > 0) {
+        const Entry current = stack[--top];
+        if (current.distanceSquared > best) continue;
+        const BvhNode& node = nodes[current.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const float d = distanceSquared(point, itemMin[items[i]], itemMax[items[i]]);
+                if (d < best || (d == best && closest == InvalidIndex)) {
+                    best = d;
+                    closest = items[i];
+                }
+            }
+            continue;
+        }
+        Entry near{ node.first, distanceSquared(point, nodes[node.first].min, nodes[node.first].max) };
+        Entry far{ node.first + 1, distanceSquared(point, nodes[node.first + 1].min, nodes[node.first + 1].max) };
+        if (far.distanceSquared < near.distanceSquared) std::swap(near, far);
+        if (far.distanceSquared <= best) stack[top++] = far;
+        if (near.distanceSquared <= best) stack[top++] = near;
+    }
+    distance = std::sqrt(best);
+    return closest;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef INSTANCEBVH_H
+#define INSTANCEBVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "FrustumCulling.h"
+#include "BvhBuilder.h"
+
+// Bounding volume hierarchy over instance AABBs, for culling and spatial
+// queries that visit O(log n) nodes instead of every instance. build() makes
+// a binned SAH tree (see BvhBuilder); when instances move, refit() updates
+// the node bounds in O(n) without changing the topology, and degraded() tells
+// when the refitted tree has become loose enough that another build() pays off.
+// Query results are instance indices into the AabbList given to build().
+class InstanceBvh {
+public:
+    static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+    void build(const AabbList& bounds);
+    // Same instances, new bounds
+    void refit(const AabbList& bounds);
+    // Surface area cost of the tree relative to right after build()
+    float quality() const { return builtCost > 0.0f ? cost / builtCost : 1.0f; }
+    bool degraded() const { return quality() > 1.5f; }
+
+    size_t size() const { return items.size(); }
+    const std::vector<BvhNode>& getNodes() const { return nodes; }
+
+    // Appends every instance whose box is not entirely outside a plane
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+    // Closest instance whose box the ray enters within maxDistance (box entry
+    // distance in units of direction); InvalidIndex when none
+    uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+    // Nearest-first traversal with a caller-side exact test: hit(index, boxDistance)
+    // returns the instance's own hit distance, or infinity for a miss
+    template <typename HitFn>
+    uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, HitFn hit) const;
+    // Appends every instance whose box is within radius of center
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& found) const;
+    // Instance whose box is closest to point, at most maxDistance away; InvalidIndex when none
+    uint32_t nearest(const glm::vec3& point, float maxDistance, float& distance) const;
+
+private:
+    std::vector<BvhNode> nodes;    // root first, children always after their parent
+    std::vector<uint32_t> items;   // instance indices, grouped by leaf
+    std::vector<glm::vec3> itemMin, itemMax;  // copied from the AabbList, in instance order
+    float cost = 0.0f, builtCost = 0.0f;
+
+    static constexpr int MaxDepth = BvhBuilder::MaxDepth;
+    float rayBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const;
+    float rayItem(uint32_t item, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) const;
+};
+
+template <typename HitFn>
+uint32_t InstanceBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, HitFn hit) const {
+    distance = maxDistance;
+    uint32_t closest = InvalidIndex;
+    if (nodes.empty()) return closest;
+    const glm::vec3 inverseDirection = BvhBuilder::InverseDirection(direction);
+
+    // Each stack entry keeps the entry distance it was pushed with, so nodes
+    // behind a hit found in the meantime are skipped without a second box test
+    struct Entry { uint32_t node; float entry; };
+    Entry stack[MaxDepth];
+    int top = 0;
+    const float rootEntry = rayBox(nodes[0], origin, inverseDirection, distance);
+    if (rootEntry == std::numeric_limits<float>::infinity()) return closest;
+    stack[top++] = { 0, rootEntry };
+    while (top > 0) {
+        const Entry current = stack[--top];
+        if (current.entry > distance) continue;
+        const BvhNode& node = nodes[current.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const float entry = rayItem(items[i], origin, inverseDirection, distance);
+                if (entry == std::numeric_limits<float>::infinity()) continue;
+                const float t = hit(items[i], entry);
+                if (t < distance) {
+                    distance = t;
+                    closest = items[i];
+                }
+            }
+            continue;
+        }
+        // Visit the nearer child first; it is pushed last
+        float near = rayBox(nodes[node.first], origin, inverseDirection, distance);
+        float far = rayBox(nodes[node.first + 1], origin, inverseDirection, distance);
+        uint32_t nearNode = node.first, farNode = node.first + 1;
+        if (far < near) {
+            std::swap(near, far);
+            std::swap(nearNode, farNode);
+        }
+        if (far != std::numeric_limits<float>::infinity()) stack[top++] = { farNode, far };
+        if (near != std::numeric_limits<float>::infinity()) stack[top++] = { nearNode, near };
+    }
+    return closest;
+}
+
+#endif
\ No newline at end of file
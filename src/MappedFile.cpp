@@ -0,0 +1,61 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_HAS_MMAP 1
+#endif
+
+MappedFile::MappedFile(const std::string& filepath) {
+    if (map(filepath)) return;
+
+    // Fallback: copy the stream into memory
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) return;
+    std::ostringstream ss;
+    ss << file.rdbuf();
+    buffer = ss.str();
+    opened = true;
+}
+
+MappedFile::~MappedFile() {
+#ifdef MAPPEDFILE_HAS_MMAP
+    if (mapping) munmap(mapping, length);
+#endif
+}
+
+bool MappedFile::map(const std::string& filepath) {
+#ifdef MAPPEDFILE_HAS_MMAP
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {  // mmap rejects empty ranges
+        close(fd);
+        opened = true;
+        return true;
+    }
+
+    void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps its own reference to the file
+    if (ptr == MAP_FAILED) return false;
+
+    mapping = ptr;
+    length = static_cast<size_t>(st.st_size);
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    madvise(mapping, length, MADV_WILLNEED);
+    opened = true;
+    return true;
+#else
+    (void)filepath;
+    return false;
+#endif
+}
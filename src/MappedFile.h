@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file. Regular files are memory-mapped and advised
+// for sequential access, so parsers read straight out of the page cache.
+// Pipes, devices and platforms without mmap fall back to an ifstream copy.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filepath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    bool isMapped() const { return mapping != nullptr; }
+    const char* data() const { return mapping ? static_cast<const char*>(mapping) : buffer.data(); }
+    size_t size() const { return mapping ? length : buffer.size(); }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+    std::string buffer;   // fallback storage when the file is not mapped
+    bool opened = false;
+
+    bool map(const std::string& filepath);
+};
+
+#endif
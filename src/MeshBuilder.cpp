@@ -0,0 +1,145 @@
+#include "MeshBuilder.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Corners per batch; small enough to balance, large enough to amortize a thread
+constexpr size_t GatherBatch = 16384;
+
+// A contiguous run of one material group's corners
+struct CornerRange {
+    uint32_t materialId;
+    size_t begin, end;
+    uint32_t firstVertex;  // group-local number of the range's first new vertex
+};
+
+} // namespace
+
+void MeshBuilder::Assemble(const ObjData& obj, std::vector<std::vector<float>>& vertexData,
+                           std::vector<std::vector<uint32_t>>& indexData) {
+    const size_t materialCount = obj.materialNames.size();
+    const size_t cornerCount = obj.faceVertices.size();
+    vertexData.assign(materialCount, {});
+    indexData.assign(materialCount, {});
+    // ObjParser drops faces indexing outside the attribute arrays; the counting
+    // sort below writes through faceVertices, so a stray index would corrupt memory
+    assert(std::all_of(obj.faceVertices.begin(), obj.faceVertices.end(), [&](int v) { return v >= 0 && static_cast<size_t>(v) < obj.vertices.size(); }));
+    assert(std::all_of(obj.faceTexCoords.begin(), obj.faceTexCoords.end(), [&](int vt) { return vt >= -1 && vt < static_cast<int>(obj.texCoords.size()); }));
+    assert(std::all_of(obj.faceNormals.begin(), obj.faceNormals.end(), [&](int vn) { return vn >= -1 && vn < static_cast<int>(obj.normals.size()); }));
+
+    // Corners grouped by position index, ascending within each bucket (a
+    // counting sort). Equal corners share their position, so each corner only
+    // has to be compared with the earlier corners of its own bucket.
+    std::vector<uint32_t> bucketStart(obj.vertices.size() + 1, 0), bucketCorners(cornerCount);
+    for (size_t c = 0; c < cornerCount; ++c) ++bucketStart[obj.faceVertices[c] + 1];
+    for (size_t v = 0; v < obj.vertices.size(); ++v) bucketStart[v + 1] += bucketStart[v];
+    {
+        std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t c = 0; c < cornerCount; ++c) bucketCorners[fill[obj.faceVertices[c]]++] = static_cast<uint32_t>(c);
+    }
+
+    // owner[c] is the first corner of c's material group with the same
+    // (v, vt, vn); a corner that owns itself introduces a new vertex
+    std::vector<uint32_t> owner(cornerCount);
+    ParallelFor(obj.vertices.size(), GatherBatch / 4, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const uint32_t* corners = bucketCorners.data() + bucketStart[v];
+            const size_t count = bucketStart[v + 1] - bucketStart[v];
+            // Groups are contiguous in corner order, so each one is a run of the bucket
+            size_t run = 0, runEnd = 0;
+            for (size_t k = 0; k < count; ++k) {
+                const uint32_t c = corners[k];
+                if (c >= runEnd) {
+                    run = k;
+                    runEnd = *std::upper_bound(obj.materialFaceStart.begin(), obj.materialFaceStart.end(), c / 3) * 3;
+                }
+                owner[c] = c;
+                for (size_t j = run; j < k; ++j) {
+                    const uint32_t e = corners[j];
+                    if (obj.faceTexCoords[e] == obj.faceTexCoords[c] && obj.faceNormals[e] == obj.faceNormals[c]) {
+                        owner[c] = e;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+    std::vector<uint32_t>().swap(bucketCorners);
+    std::vector<uint32_t>().swap(bucketStart);
+
+    // Pass 1: split every group into ranges of corners and count the new
+    // vertices in each; a prefix sum over a group's ranges gives every range
+    // its first vertex number and the group its exact vertex count
+    std::vector<CornerRange> ranges;
+    for (uint32_t id = 0; id < materialCount; ++id) {
+        const size_t first = obj.materialFaceStart[id] * 3, last = obj.materialFaceStart[id + 1] * 3;
+        for (size_t begin = first; begin < last; begin += GatherBatch) ranges.push_back({ id, begin, std::min(begin + GatherBatch, last), 0 });
+    }
+    std::vector<uint32_t> rangeVertices(ranges.size(), 0);
+    ParallelFor(ranges.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            for (size_t c = ranges[r].begin; c < ranges[r].end; ++c) rangeVertices[r] += owner[c] == c;
+        }
+    });
+    std::vector<uint32_t> groupVertices(materialCount, 0);
+    for (size_t r = 0; r < ranges.size(); ++r) {
+        ranges[r].firstVertex = groupVertices[ranges[r].materialId];
+        groupVertices[ranges[r].materialId] += rangeVertices[r];
+    }
+
+    // Every stream is now sized once. sources[id] records the corner that
+    // introduced each vertex; new vertices get their index first, and the
+    // repeated corners copy their owner's in a second sweep.
+    std::vector<std::vector<uint32_t>> sources(materialCount);
+    for (size_t id = 0; id < materialCount; ++id) {
+        sources[id].resize(groupVertices[id]);
+        indexData[id].resize((obj.materialFaceStart[id + 1] - obj.materialFaceStart[id]) * 3);
+    }
+    ParallelFor(ranges.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            const size_t first = obj.materialFaceStart[ranges[r].materialId] * 3;
+            std::vector<uint32_t>& indices = indexData[ranges[r].materialId];
+            std::vector<uint32_t>& source = sources[ranges[r].materialId];
+            uint32_t vertex = ranges[r].firstVertex;
+            for (size_t c = ranges[r].begin; c < ranges[r].end; ++c) {
+                if (owner[c] != c) continue;
+                source[vertex] = static_cast<uint32_t>(c);
+                indices[c - first] = vertex++;
+            }
+        }
+    });
+    ParallelFor(ranges.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            const size_t first = obj.materialFaceStart[ranges[r].materialId] * 3;
+            std::vector<uint32_t>& indices = indexData[ranges[r].materialId];
+            for (size_t c = ranges[r].begin; c < ranges[r].end; ++c) {
+                if (owner[c] != c) indices[c - first] = indices[owner[c] - first];
+            }
+        }
+    });
+    std::vector<uint32_t>().swap(owner);
+
+    // Pass 2: every vertex is written straight to its final slot
+    for (size_t id = 0; id < materialCount; ++id) {
+        std::vector<float>& vertices = vertexData[id];
+        const std::vector<uint32_t>& source = sources[id];
+        vertices.resize(source.size() * Stride);
+        ParallelFor(source.size(), GatherBatch, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                const size_t c = source[v];
+                const Vertex& p = obj.vertices[obj.faceVertices[c]];
+                // Corners without vt/vn (e.g. "f 1//3") fall back to zeros
+                const int vt = obj.faceTexCoords[c], vn = obj.faceNormals[c];
+                const TexCoord t = vt >= 0 ? obj.texCoords[vt] : TexCoord{ 0.0f, 0.0f };
+                const Normal n = vn >= 0 ? obj.normals[vn] : Normal{ 0.0f, 0.0f, 0.0f };
+
+                float* out = vertices.data() + v * Stride;
+                out[0] = p.x; out[1] = p.y; out[2] = p.z;  // Position
+                out[3] = t.u; out[4] = t.v;                // Texture coordinates
+                out[5] = n.x; out[6] = n.y; out[7] = n.z;  // Normal
+            }
+        });
+    }
+}
\ No newline at end of file
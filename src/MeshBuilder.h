@@ -0,0 +1,25 @@
+#ifndef MESHBUILDER_H
+#define MESHBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ObjParser.h"
+
+// Turns parsed OBJ faces into one indexed triangle list per material
+class MeshBuilder {
+public:
+    // Floats per assembled vertex: position xyz, texture coordinate uv, normal xyz
+    static constexpr size_t Stride = 8;
+
+    // Deduplicates equal (v, vt, vn) corners within each material group and
+    // writes the unique vertices and the indices into them, both indexed by
+    // material ID. Every stream is allocated once at its exact size: the new
+    // vertices are counted per range of corners, a prefix sum over the ranges
+    // numbers them, and indices and vertices are then written in parallel
+    // straight to their slots, so a single-material mesh is split too.
+    static void Assemble(const ObjData& obj, std::vector<std::vector<float>>& vertexData,
+                         std::vector<std::vector<uint32_t>>& indexData);
+};
+
+#endif
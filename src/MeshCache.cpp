@@ -0,0 +1,260 @@
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char Magic[8] = { 'G', 'R', 'F', 'K', 'M', 'E', 'S', 'H' };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t materialCount;
+    uint64_t sourceHash;
+    uint32_t groupCount;
+    uint32_t vertexFormat;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Sections that hold float data start on this boundary
+constexpr size_t Alignment = 16;
+
+class Writer {
+public:
+    explicit Writer(std::ofstream& out) : out(out) {}
+
+    void bytes(const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        offset += size;
+    }
+    template <typename T> void value(const T& v) { bytes(&v, sizeof(T)); }
+    void string(const std::string& s) {
+        value(static_cast<uint32_t>(s.size()));
+        bytes(s.data(), s.size());
+    }
+    void align() {
+        static const char zeros[Alignment] = {};
+        bytes(zeros, (Alignment - offset % Alignment) % Alignment);
+    }
+
+private:
+    std::ofstream& out;
+    size_t offset = 0;
+};
+
+// Bounds-checked cursor over the mapped file
+class Reader {
+public:
+    Reader(const char* data, size_t size) : data(data), size(size) {}
+
+    const char* bytes(size_t count) {
+        if (failed || count > size - offset) {
+            failed = true;
+            return nullptr;
+        }
+        const char* p = data + offset;
+        offset += count;
+        return p;
+    }
+    template <typename T> bool value(T& v) {
+        const char* p = bytes(sizeof(T));
+        if (p) std::memcpy(&v, p, sizeof(T));
+        return p != nullptr;
+    }
+    bool string(std::string& s) {
+        uint32_t length = 0;
+        if (!value(length)) return false;
+        const char* p = bytes(length);
+        if (p) s.assign(p, length);
+        return p != nullptr;
+    }
+    void align() { bytes((Alignment - offset % Alignment) % Alignment); }
+    bool ok() const { return !failed; }
+
+private:
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+    bool failed = false;
+};
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace
+
+uint64_t MeshCache::Hash(const char* data, size_t size, uint64_t seed) {
+    const uint64_t k1 = 0x9e3779b97f4a7c15ULL, k2 = 0xc2b2ae3d27d4eb4fULL;
+    // Four independent lanes so the multiplies pipeline on large inputs
+    uint64_t lanes[4] = { seed + k1, seed ^ k2, seed - k1, ~seed };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; ++l) {
+            uint64_t w;
+            std::memcpy(&w, data + i + 8 * l, 8);
+            lanes[l] = rotl(lanes[l] + w * k2, 31) * k1;
+        }
+    }
+    uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    for (; i < size; ++i) {
+        h = rotl(h ^ (static_cast<unsigned char>(data[i]) * k1), 11) * k2;
+    }
+    return fmix(h ^ size);
+}
+
+bool MeshCache::open(const std::string& path, uint64_t sourceHash) {
+    file = std::make_unique<MappedFile>(path);
+    if (file->isOpen() && parse(sourceHash)) return true;
+
+    // A rejected cache keeps neither its mapping nor anything read from it
+    file.reset();
+    vertexFormat = VertexFormat::Float32;
+    materials.clear();
+    groups.clear();
+    boundsMin = boundsMax = glm::vec3(0.0f);
+    return false;
+}
+
+bool MeshCache::parse(uint64_t sourceHash) {
+    Reader in(file->data(), file->size());
+    Header header;
+    if (!in.value(header) || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version || header.sourceHash != sourceHash) {
+        return false;
+    }
+    if (header.vertexFormat > static_cast<uint32_t>(VertexFormat::Packed)) return false;
+    vertexFormat = static_cast<VertexFormat>(header.vertexFormat);
+    const size_t stride = VertexLayout::Stride(vertexFormat);
+    boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    materials.resize(header.materialCount);
+    for (Material& m : materials) {
+        in.string(m.name);
+        in.value(m.Ka);
+        in.value(m.Kd);
+        in.value(m.Ks);
+        in.value(m.Ns);
+        in.string(m.diffuseTexture);
+    }
+
+    groups.resize(header.groupCount);
+    for (Group& g : groups) {
+        uint64_t vertexCount = 0, indexCount = 0;
+        in.value(g.materialId);
+        in.value(vertexCount);
+        in.value(indexCount);
+        in.value(g.indexSize);
+        in.value(g.boundsMin);
+        in.value(g.boundsMax);
+        uint32_t lodCount = 0;
+        in.value(lodCount);
+        if (!in.ok() || g.materialId >= materials.size() || lodCount > 64) return false;
+        g.lods.resize(lodCount);
+        for (LodLevel& lod : g.lods) {
+            in.value(lod.indexOffset);
+            in.value(lod.indexCount);
+            in.value(lod.error);
+            if (static_cast<uint64_t>(lod.indexOffset) + lod.indexCount > indexCount) return false;
+        }
+        uint32_t meshletCount = 0;
+        in.value(meshletCount);
+        const char* meshletData = in.bytes(static_cast<size_t>(meshletCount) * sizeof(Meshlet));
+        if (!meshletData) return false;
+        g.meshlets.resize(meshletCount);
+        std::memcpy(g.meshlets.data(), meshletData, g.meshlets.size() * sizeof(Meshlet));
+        for (const Meshlet& m : g.meshlets) {
+            if (static_cast<uint64_t>(m.indexOffset) + m.indexCount > indexCount) return false;
+        }
+        in.align();
+        g.vertexCount = static_cast<size_t>(vertexCount);
+        g.vertexData = in.bytes(g.vertexCount * stride);
+        in.align();
+        g.indexCount = static_cast<size_t>(indexCount);
+        if (g.indexSize != 2 && g.indexSize != 4) return false;
+        g.indexData = in.bytes(g.indexCount * g.indexSize);
+    }
+    return in.ok();
+}
+
+bool MeshCache::Write(const std::string& path, uint64_t sourceHash,
+                      const std::vector<Material>& materials,
+                      VertexFormat vertexFormat, const std::vector<Group>& groups,
+                      const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    // Write to a temporary name and rename, so a crash never leaves a torn cache
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Failed to write mesh cache: " << path << std::endl;
+            return false;
+        }
+        Writer out(file);
+
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.materialCount = static_cast<uint32_t>(materials.size());
+        header.sourceHash = sourceHash;
+        header.groupCount = static_cast<uint32_t>(groups.size());
+        header.vertexFormat = static_cast<uint32_t>(vertexFormat);
+        for (int i = 0; i < 3; ++i) {
+            header.boundsMin[i] = boundsMin[i];
+            header.boundsMax[i] = boundsMax[i];
+        }
+        out.value(header);
+
+        for (const Material& m : materials) {
+            out.string(m.name);
+            out.value(m.Ka);
+            out.value(m.Kd);
+            out.value(m.Ks);
+            out.value(m.Ns);
+            out.string(m.diffuseTexture);
+        }
+        const size_t stride = VertexLayout::Stride(vertexFormat);
+        for (const Group& g : groups) {
+            out.value(g.materialId);
+            out.value(static_cast<uint64_t>(g.vertexCount));
+            out.value(static_cast<uint64_t>(g.indexCount));
+            out.value(g.indexSize);
+            out.value(g.boundsMin);
+            out.value(g.boundsMax);
+            out.value(static_cast<uint32_t>(g.lods.size()));
+            for (const LodLevel& lod : g.lods) {
+                out.value(lod.indexOffset);
+                out.value(lod.indexCount);
+                out.value(lod.error);
+            }
+            out.value(static_cast<uint32_t>(g.meshlets.size()));
+            out.bytes(g.meshlets.data(), g.meshlets.size() * sizeof(Meshlet));
+            out.align();
+            out.bytes(g.vertexData, g.vertexCount * stride);
+            out.align();
+            out.bytes(g.indexData, g.indexCount * g.indexSize);
+        }
+        if (!file) {
+            std::cerr << "Failed to write mesh cache: " << path << std::endl;
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write mesh cache: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
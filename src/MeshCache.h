@@ -0,0 +1,72 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+
+// Baked, versioned binary form of a processed Model: the material table, the
+// per-material vertex and index streams in their GPU format, the LOD ranges,
+// the meshlets and the model and group bounds. It is written next
+// to the OBJ after the first load and keyed by a hash of the OBJ/MTL bytes,
+// so later runs can memory-map it and upload the streams without parsing.
+class MeshCache {
+public:
+    // Bump whenever the on-disk layout changes; older files are then rebuilt
+    static constexpr uint32_t Version = 8;
+
+    // Ready-to-upload view of one material group's buffers
+    struct Group {
+        uint32_t materialId;      // index into the material table
+        const void* vertexData;   // vertexCount vertices in vertexFormat
+        size_t vertexCount;
+        const void* indexData;    // uint16_t or uint32_t triangle list, see indexSize
+        size_t indexCount;
+        uint32_t indexSize;
+        std::vector<LodLevel> lods;  // index ranges per level of detail, finest first
+        std::vector<Meshlet> meshlets;
+        glm::vec3 boundsMin{ 0.0f }, boundsMax{ 0.0f };  // of the group's own vertices, in model space
+    };
+
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    std::vector<Material> materials;  // indexed by material ID
+    std::vector<Group> groups;  // point into the mapped file
+    glm::vec3 boundsMin{ 0.0f }, boundsMax{ 0.0f };
+
+    // Maps the cache at path. Returns false when it is missing, truncated,
+    // from another version or was baked from different source bytes; the
+    // cache is then left empty and unmapped.
+    bool open(const std::string& path, uint64_t sourceHash);
+
+    // Size of the mapping the groups point into
+    size_t mappedBytes() const { return file ? file->size() : 0; }
+
+    static bool Write(const std::string& path, uint64_t sourceHash,
+                      const std::vector<Material>& materials,
+                      VertexFormat vertexFormat, const std::vector<Group>& groups,
+                      const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Groups with fewer than 65536 vertices are stored and drawn with 16-bit indices
+    static bool UseShortIndices(size_t vertexCount) { return vertexCount < 65536; }
+
+    static std::string PathFor(const std::string& objPath) { return objPath + ".meshcache"; }
+
+    // Fast non-cryptographic 64-bit hash used as the cache key
+    static uint64_t Hash(const char* data, size_t size, uint64_t seed = 0);
+
+private:
+    std::unique_ptr<MappedFile> file;
+
+    // Reads the mapped file into the fields above; false when it is rejected
+    bool parse(uint64_t sourceHash);
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Size of the LRU cache modelled by the Forsyth scorer
+constexpr int CacheSize = 32;
+
+// Forsyth's vertex score: recently used vertices and vertices with few
+// remaining triangles are preferred
+float vertexScore(int cachePosition, unsigned remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = 0.75f;  // the last triangle's vertices get a fixed score to avoid strips
+        } else {
+            const float scaler = 1.0f / (CacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+        }
+    }
+    return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+// Counts FIFO cache misses with per-vertex timestamps instead of a queue
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, unsigned size) : timestamps(vertexCount, 0), size(size), time(size + 1) {}
+
+    // Returns true on a miss
+    bool touch(uint32_t v) {
+        if (time - timestamps[v] > size) {
+            timestamps[v] = time++;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::vector<unsigned> timestamps;
+    unsigned size;
+    unsigned time;
+};
+
+} // namespace
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Triangle adjacency per vertex (CSR); the first remaining[v] entries are live
+    std::vector<unsigned> remaining(vertexCount, 0);
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) ++remaining[indices[i]];
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    }
+
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> result(triangleCount * 3);
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(CacheSize + 3);
+    nextCache.reserve(CacheSize + 3);
+
+    long best = static_cast<long>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    size_t cursor = 0;
+
+    for (size_t out = 0; out < triangleCount; ++out) {
+        // Nothing adjacent to the cache is left: restart at the next unemitted triangle
+        if (best < 0) {
+            while (emitted[cursor]) ++cursor;
+            best = static_cast<long>(cursor);
+        }
+
+        const uint32_t* tri = indices + best * 3;
+        std::copy(tri, tri + 3, result.begin() + out * 3);
+        emitted[best] = 1;
+
+        // Drop the triangle from its vertices' live adjacency
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = tri[k];
+            uint32_t* list = adjacency.data() + offsets[v];
+            uint32_t* last = list + remaining[v] - 1;
+            *std::find(list, last + 1, static_cast<uint32_t>(best)) = *last;
+            --remaining[v];
+        }
+
+        // The emitted vertices move to the front of the cache
+        nextCache.assign(tri, tri + 3);
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+        }
+
+        // Rescore everything that was or is in the cache and propagate to its triangles
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            const uint32_t v = nextCache[i];
+            cachePosition[v] = (i < CacheSize) ? static_cast<int>(i) : -1;
+            const float newScore = vertexScore(cachePosition[v], remaining[v]);
+            const float delta = newScore - score[v];
+            score[v] = newScore;
+            for (unsigned j = 0; j < remaining[v]; ++j) triangleScore[adjacency[offsets[v] + j]] += delta;
+        }
+        if (nextCache.size() > CacheSize) nextCache.resize(CacheSize);
+        std::swap(cache, nextCache);
+
+        // Next pick: best live triangle touching the cache
+        best = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            for (unsigned j = 0; j < remaining[v]; ++j) {
+                const uint32_t t = adjacency[offsets[v] + j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = static_cast<long>(t);
+                }
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* vertexData, size_t stride,
+                                     size_t vertexCount, float threshold) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) return;
+
+    // Clusters start wherever the cache-optimized order restarts cold (all three
+    // vertices miss), so moving whole clusters around keeps most of the hit rate
+    std::vector<size_t> clusterStarts;
+    {
+        FifoCache cache(vertexCount, 16);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k) misses += cache.touch(indices[t * 3 + k]);
+            if (t == 0 || misses == 3) clusterStarts.push_back(t);
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    const size_t clusterCount = clusterStarts.size() - 1;
+    if (clusterCount < 2) return;
+
+    auto position = [&](uint32_t v, int axis) { return vertexData[v * stride + axis]; };
+
+    // Area-weighted centroid and normal per cluster, and of the whole mesh
+    std::vector<float> clusterData(clusterCount * 6, 0.0f);  // centroid xyz, normal xyz
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float* data = &clusterData[c * 6];
+        float area = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            const uint32_t a = indices[t * 3], b = indices[t * 3 + 1], d = indices[t * 3 + 2];
+            float e1[3], e2[3], n[3];
+            for (int i = 0; i < 3; ++i) {
+                e1[i] = position(b, i) - position(a, i);
+                e2[i] = position(d, i) - position(a, i);
+            }
+            n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            const float triArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; ++i) {
+                data[i] += (position(a, i) + position(b, i) + position(d, i)) / 3.0f * triArea;
+                data[3 + i] += n[i];
+            }
+            area += triArea;
+        }
+        for (int i = 0; i < 3; ++i) meshCentroid[i] += data[i];
+        meshArea += area;
+        if (area > 0.0f) {
+            for (int i = 0; i < 3; ++i) data[i] /= area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        for (float& c : meshCentroid) c /= meshArea;
+    }
+
+    // Clusters that face away from the mesh centre are likely to occlude others
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        const float* data = &clusterData[c * 6];
+        const float length = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        float key = 0.0f;
+        if (length > 0.0f) {
+            for (int i = 0; i < 3; ++i) key += (data[i] - meshCentroid[i]) * data[3 + i] / length;
+        }
+        sortKey[c] = key;
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (size_t c : order) {
+        result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+    }
+
+    const float before = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount).acmr;
+    const float after = AnalyzeVertexCache(result.data(), result.size(), vertexCount).acmr;
+    if (after <= before * threshold) {
+        std::copy(result.begin(), result.end(), indices);
+    }
+}
+
+void MeshOptimizer::OptimizeVertexFetch(float* vertexData, size_t stride, uint32_t* indices, size_t indexCount,
+                                        size_t vertexCount) {
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t& target = remap[indices[i]];
+        if (target == unused) target = next++;
+        indices[i] = target;
+    }
+
+    // Unreferenced vertices keep their relative order at the end
+    for (uint32_t& target : remap) {
+        if (target == unused) target = next++;
+    }
+
+    std::vector<float> reordered(vertexCount * stride);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        std::copy(vertexData + v * stride, vertexData + (v + 1) * stride, reordered.begin() + remap[v] * stride);
+    }
+    std::copy(reordered.begin(), reordered.end(), vertexData);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                                   unsigned cacheSize) {
+    FifoCache cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) misses += cache.touch(indices[i]);
+
+    VertexCacheStats stats{ 0.0f, 0.0f };
+    if (indexCount >= 3) stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    if (vertexCount > 0) stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return stats;
+}
@@ -0,0 +1,35 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Post-transform cache statistics of a triangle list
+struct VertexCacheStats {
+    float acmr;  // average cache misses per triangle (0.5 is ideal for large grids, 3.0 is worst)
+    float atvr;  // average transformed vertices per vertex (1.0 is ideal)
+};
+
+// Reordering passes for indexed triangle lists, run in this order:
+// vertex cache -> overdraw -> vertex fetch. All passes work in place.
+class MeshOptimizer {
+public:
+    // Forsyth-style greedy triangle reordering for the post-transform vertex cache
+    static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // Splits the cache-optimized list into clusters at cache restarts and sorts the
+    // clusters so outward-facing ones draw first. The result is only kept when it
+    // raises ACMR by less than the given factor.
+    static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const float* vertexData, size_t stride,
+                                 size_t vertexCount, float threshold = 1.05f);
+
+    // Renumbers vertices in first-use order and permutes the interleaved vertex
+    // data (stride floats per vertex) to match, so fetches walk memory linearly
+    static void OptimizeVertexFetch(float* vertexData, size_t stride, uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    // FIFO cache simulation of the given size
+    static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                               unsigned cacheSize = 16);
+};
+
+#endif
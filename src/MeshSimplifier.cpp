@@ -0,0 +1,206 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Symmetric 4x4 quadric of summed squared plane distances
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    void addPlane(double a, double b, double c, double d) {
+        a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+        b2 += b * b; bc += b * c; bd += b * d;
+        c2 += c * c; cd += c * d;
+        d2 += d * d;
+    }
+    void add(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+    }
+    double evaluate(const float* p) const {
+        const double x = p[0], y = p[1], z = p[2];
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z + d2;
+    }
+};
+
+struct Collapse {
+    uint32_t from, to;
+    double cost;
+};
+
+inline void triangleNormal(const float* a, const float* b, const float* c, float* n) {
+    const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+struct PositionKey {
+    uint32_t bits[3];
+    bool operator==(const PositionKey& o) const { return std::memcmp(bits, o.bits, sizeof(bits)) == 0; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& k) const {
+        return (k.bits[0] * 73856093u) ^ (k.bits[1] * 19349663u) ^ (k.bits[2] * 83492791u);
+    }
+};
+
+} // namespace
+
+size_t MeshSimplifier::Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                                const float* vertexData, size_t stride, size_t vertexCount,
+                                size_t targetIndexCount, float& resultError) {
+    auto position = [&](uint32_t v) { return vertexData + v * stride; };
+    std::vector<uint32_t> triangles(indices, indices + indexCount);
+    resultError = 0.0f;
+
+    // Weld vertices by position: vertices that only differ in UV/normal form a seam
+    std::vector<uint32_t> weld(vertexCount);
+    std::vector<uint32_t> weldCount(vertexCount, 0);
+    {
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAt;
+        firstAt.reserve(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            PositionKey key;
+            std::memcpy(key.bits, position(v), sizeof(key.bits));
+            weld[v] = firstAt.try_emplace(key, v).first->second;
+            ++weldCount[weld[v]];
+        }
+    }
+
+    // Lock seam vertices and open-border vertices so the silhouette and UV charts hold
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> edgeUse;
+        edgeUse.reserve(indexCount);
+        auto edgeKey = [&](uint32_t a, uint32_t b) {
+            a = weld[a];
+            b = weld[b];
+            if (a > b) std::swap(a, b);
+            return (static_cast<uint64_t>(a) << 32) | b;
+        };
+        for (size_t t = 0; t + 2 < indexCount; t += 3) {
+            for (int k = 0; k < 3; ++k) ++edgeUse[edgeKey(triangles[t + k], triangles[t + (k + 1) % 3])];
+        }
+        for (size_t t = 0; t + 2 < indexCount; t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t a = triangles[t + k], b = triangles[t + (k + 1) % 3];
+                if (edgeUse[edgeKey(a, b)] != 2) locked[a] = locked[b] = 1;
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (weldCount[weld[v]] > 1) locked[v] = 1;
+        }
+    }
+
+    // Plane quadrics of the incident triangles
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const float* a = position(triangles[t]);
+        float n[3];
+        triangleNormal(a, position(triangles[t + 1]), position(triangles[t + 2]), n);
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) continue;
+        const double nx = n[0] / length, ny = n[1] / length, nz = n[2] / length;
+        const double d = -(nx * a[0] + ny * a[1] + nz * a[2]);
+        for (int k = 0; k < 3; ++k) quadrics[triangles[t + k]].addPlane(nx, ny, nz, d);
+    }
+
+    double maxCost = 0.0;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<char> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency;
+    std::vector<Collapse> collapses;
+
+    while (triangles.size() > targetIndexCount) {
+        // Triangles around each vertex, for the flip test
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t v : triangles) ++adjacencyOffsets[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i) adjacency[fill[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // Every directed edge out of an unlocked vertex is a candidate
+        collapses.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t from = triangles[t + k], to = triangles[t + (k + 1) % 3];
+                Quadric q = quadrics[from];
+                q.add(quadrics[to]);
+                if (!locked[from]) collapses.push_back({ from, to, q.evaluate(position(to)) });
+                if (!locked[to]) collapses.push_back({ to, from, q.evaluate(position(from)) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Apply the cheapest independent collapses; each removes about two triangles
+        for (uint32_t v = 0; v < vertexCount; ++v) remap[v] = v;
+        std::fill(touched.begin(), touched.end(), 0);
+        const size_t trianglesToRemove = (triangles.size() - targetIndexCount) / 3;
+        size_t removed = 0, applied = 0;
+        for (const Collapse& c : collapses) {
+            if (removed >= trianglesToRemove) break;
+            if (touched[c.from] || touched[c.to]) continue;
+
+            // Reject collapses that would flip a surviving triangle
+            bool flips = false;
+            for (uint32_t i = adjacencyOffsets[c.from]; i < adjacencyOffsets[c.from + 1] && !flips; ++i) {
+                const uint32_t* tri = &triangles[adjacency[i] * 3];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) continue;
+                const float* p[3] = { position(tri[0]), position(tri[1]), position(tri[2]) };
+                float before[3], after[3];
+                triangleNormal(p[0], p[1], p[2], before);
+                for (int k = 0; k < 3; ++k) {
+                    if (tri[k] == c.from) p[k] = position(c.to);
+                }
+                triangleNormal(p[0], p[1], p[2], after);
+                // Also reject large normal swings, which fold thin regions even without a sign flip
+                const float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                const float lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                                (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+                flips = dot <= 0.25f * lengths;
+            }
+            if (flips) continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            maxCost = std::max(maxCost, c.cost);
+            // Freeze the neighbourhood so the remaining candidates this pass stay valid
+            for (uint32_t i = adjacencyOffsets[c.from]; i < adjacencyOffsets[c.from + 1]; ++i) {
+                const uint32_t* tri = &triangles[adjacency[i] * 3];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+            }
+            removed += 2;
+            ++applied;
+        }
+        if (applied == 0) break;
+
+        // Rewrite the list, dropping triangles that collapsed to a line
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            const uint32_t a = remap[triangles[t]], b = remap[triangles[t + 1]], c = remap[triangles[t + 2]];
+            if (a == b || b == c || a == c) continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+    }
+
+    resultError = static_cast<float>(std::sqrt(maxCost));
+    std::copy(triangles.begin(), triangles.end(), destination);
+    return triangles.size();
+}
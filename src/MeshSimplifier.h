@@ -0,0 +1,28 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// One level of detail: a range of a group's index buffer and the geometric
+// error (model-space distance) it introduces relative to the full mesh
+struct LodLevel {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error;
+};
+
+// Quadric-error-metric simplification by half-edge collapse. Vertices only ever
+// collapse onto other existing vertices, so every level can index the same
+// vertex buffer. UV/normal seams and open borders are locked in place.
+class MeshSimplifier {
+public:
+    // Writes at most indexCount indices to destination and returns how many were
+    // written; stops early once targetIndexCount is reached or nothing more can
+    // collapse. resultError receives the error of the simplified mesh.
+    static size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                           const float* vertexData, size_t stride, size_t vertexCount,
+                           size_t targetIndexCount, float& resultError);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "Meshlet.h"
+#include "Camera.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void finishMeshlet(Meshlet& m, const uint32_t* indices, const float* vertexData, size_t stride) {
+    auto position = [&](uint32_t v) { return glm::vec3(vertexData[v * stride], vertexData[v * stride + 1], vertexData[v * stride + 2]); };
+    const uint32_t* tris = indices + m.indexOffset;
+
+    // Sphere around the AABB centre
+    glm::vec3 lo(position(tris[0])), hi(lo);
+    for (uint32_t i = 0; i < m.indexCount; ++i) {
+        lo = glm::min(lo, position(tris[i]));
+        hi = glm::max(hi, position(tris[i]));
+    }
+    const glm::vec3 center = (lo + hi) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < m.indexCount; ++i) radius = std::max(radius, glm::length(position(tris[i]) - center));
+
+    // Normal cone: average unit normal and the widest deviation from it
+    std::vector<glm::vec3> normals;
+    normals.reserve(m.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i < m.indexCount; i += 3) {
+        const glm::vec3 a = position(tris[i]);
+        const glm::vec3 n = glm::cross(position(tris[i + 1]) - a, position(tris[i + 2]) - a);
+        const float length = glm::length(n);
+        if (length == 0.0f) continue;
+        normals.push_back(n / length);
+        axis += normals.back();
+    }
+    float cutoff = 1.0f;
+    const float axisLength = glm::length(axis);
+    if (axisLength > 0.0f) {
+        axis /= axisLength;
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(n, axis));
+        // Cones wider than ~84 degrees never cull anything useful
+        if (minDot > 0.1f) cutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        m.center[i] = center[i];
+        m.coneAxis[i] = axis[i];
+    }
+    m.radius = radius;
+    m.coneCutoff = cutoff;
+}
+
+} // namespace
+
+std::vector<Meshlet> MeshletBuilder::Build(const uint32_t* indices, size_t indexCount,
+                                           const float* vertexData, size_t stride, size_t vertexCount) {
+    std::vector<Meshlet> meshlets;
+    // Which meshlet last used each vertex, to count unique vertices cheaply
+    std::vector<uint32_t> lastMeshlet(vertexCount, ~0u);
+    Meshlet current{};
+    size_t uniqueVertices = 0;
+
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const uint32_t id = static_cast<uint32_t>(meshlets.size());
+        size_t newVertices = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (lastMeshlet[indices[t + k]] != id) ++newVertices;
+        }
+        // Duplicate corners within one triangle count once too many; that only splits early
+        if (current.indexCount > 0 &&
+            (uniqueVertices + newVertices > MaxVertices || current.indexCount / 3 >= MaxTriangles)) {
+            finishMeshlet(current, indices, vertexData, stride);
+            meshlets.push_back(current);
+            current = Meshlet{};
+            current.indexOffset = static_cast<uint32_t>(t);
+            uniqueVertices = 0;
+        }
+        const uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+        for (int k = 0; k < 3; ++k) {
+            uint32_t& last = lastMeshlet[indices[t + k]];
+            if (last != meshletId) {
+                last = meshletId;
+                ++uniqueVertices;
+            }
+        }
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0) {
+        finishMeshlet(current, indices, vertexData, stride);
+        meshlets.push_back(current);
+    }
+    return meshlets;
+}
+
+bool MeshletBuilder::IsVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition) {
+    const glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+    if (!frustum.intersectsSphere(center, meshlet.radius)) return false;
+
+    // Every triangle faces away when the view direction lies inside the widened cone
+    const glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+    const glm::vec3 toCenter = center - cameraPosition;
+    return glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
@@ -0,0 +1,36 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Frustum;
+
+// A contiguous run of a group's index buffer touching at most MaxVertices
+// vertices, with the bounds needed to cull it on the CPU
+struct Meshlet {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float center[3];     // bounding sphere
+    float radius;
+    float coneAxis[3];   // average facing of the triangles
+    float coneCutoff;    // cos of the cone half-angle widened to 90 deg; 1 = never back-facing
+};
+
+class MeshletBuilder {
+public:
+    static constexpr size_t MaxVertices = 64;
+    static constexpr size_t MaxTriangles = 124;
+
+    // Splits the triangle list, in its current order, into meshlets. Run it on
+    // a cache-optimized list so consecutive triangles are spatially close.
+    static std::vector<Meshlet> Build(const uint32_t* indices, size_t indexCount,
+                                      const float* vertexData, size_t stride, size_t vertexCount);
+
+    // Frustum and back-facing cone test, both in the meshlet's (model) space
+    static bool IsVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition);
+};
+
+#endif
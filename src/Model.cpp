@@ -1,184 +1,668 @@
 #include "Model.h"
 #include "Texture.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshBuilder.h"
+#include "GeometryArena.h"
+#include "UniformBuffers.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <limits>
+#include <chrono>
 
-Model::Model(const std::string& objPath, const std::string& mtlPath) {
-    loadOBJ(objPath);
-    loadMTL(mtlPath);
-    processVertexData();
+Model::Model(const std::string& objPath, const std::string& mtlPath, const ModelOptions& options) {
+    vertexFormat = options.vertexFormat;
+    lodPixelError = options.lodPixelError;
+    retention = options.retention;
+    if (options.progressive) {
+        // Parsing runs on a worker; the render loop pulls the result in through Upload()
+        loader = std::thread(&Model::prepare, this, objPath, mtlPath, options);
+    } else {
+        prepare(objPath, mtlPath, options);
+        Upload(std::numeric_limits<double>::infinity());
+    }
+}
+
+void Model::prepare(const std::string& objPath, const std::string& mtlPath, const ModelOptions& options) {
+    auto loadStart = std::chrono::steady_clock::now();
+    MappedFile objFile(objPath);
+    MappedFile mtlFile(mtlPath);
+    if (!objFile.isOpen()) std::cerr << "Failed to open OBJ file: " << objPath << std::endl;
+    if (!mtlFile.isOpen()) std::cerr << "Failed to open MTL file: " << mtlPath << std::endl;
+
+    // The baked cache is only valid for the exact OBJ/MTL bytes and options it was built from
+    const uint32_t bakeFlags = (options.optimizeMesh ? 1u : 0u) | (static_cast<uint32_t>(vertexFormat) << 1) |
+                               (static_cast<uint32_t>(std::max(options.lodCount, 0)) << 2) | (options.buildMeshlets ? 1u << 10 : 0u);
+    uint64_t sourceHash = MeshCache::Hash(mtlFile.data(), mtlFile.size(), MeshCache::Hash(objFile.data(), objFile.size()));
+    sourceHash = MeshCache::Hash(reinterpret_cast<const char*>(&bakeFlags), sizeof(bakeFlags), sourceHash);
+    const std::string cachePath = MeshCache::PathFor(objPath);
+
+    // GPU-ready views of every group, pointing into the mapped cache or into stagingStorage
+    const bool cached = cache.open(cachePath, sourceHash);
+    if (cached) {
+        materials = cache.materials;
+        boundsMin = cache.boundsMin;
+        boundsMax = cache.boundsMax;
+        stagedGroups = cache.groups;
+    } else {
+        loadOBJ(objFile);
+        loadMTL(mtlFile);
+        processVertexData();
+        if (options.optimizeMesh) optimizeMesh();
+        if (options.buildMeshlets) buildMeshlets();
+        generateLods(options.lodCount);
+        encodeGroups(stagedGroups, stagingStorage);
+        // An unreadable or empty OBJ must not be baked, or the cache would keep serving the empty mesh
+        if (!objFile.isOpen() || objData.faceVertices.empty()) {
+            std::cerr << "No geometry in " << objPath << "; mesh cache not written" << std::endl;
+        } else if (!MeshCache::Write(cachePath, sourceHash, materials, vertexFormat, stagedGroups, boundsMin, boundsMax)) {
+            std::cerr << "Continuing without a mesh cache; the next load parses " << objPath << " again" << std::endl;
+        }
+        // The groups carry their own copies; these fill up again as groups become resident
+        groupLods.clear();
+        groupMeshlets.clear();
+    }
+    positionOffset = VertexLayout::PositionOffset(vertexFormat, boundsMin);
+    positionScale = VertexLayout::PositionScale(vertexFormat, boundsMin, boundsMax);
+    if (options.buildPickBvh) buildPickBvh();
+    if (options.buildOccluder) buildOccluder();
+    const size_t materialCount = materials.size();
+    groupAllocations.assign(materialCount, ArenaAllocation());
+    materialTextures.assign(materialCount, 0);
+    groupLods.resize(materialCount);
+    groupMeshlets.resize(materialCount);
+    groupBounds.resize(materialCount);
+    indexTypes.assign(materialCount, GL_UNSIGNED_INT);
+
+    // Decode textures here too; only the GL upload has to wait for the context thread
+    for (uint32_t id = 0; id < materialCount; ++id) {
+        if (!materials[id].diffuseTexture.empty()) {
+            std::string texturePath = "assets/" + materials[id].diffuseTexture;
+            stagedImages.emplace_back(id, TextureManager::DecodeImage(texturePath));
+        }
+    }
+
+    size_t vertexBytes = 0;
+    for (const MeshCache::Group& group : stagedGroups) {
+        vertexBytes += group.vertexCount * VertexLayout::Stride(vertexFormat);
+    }
+    std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+    std::cout << objPath << ": geometry " << (cached ? "mapped from mesh cache" : "parsed from OBJ")
+              << " in " << loadTime.count() << " ms, " << vertexBytes / 1024 << " KB of "
+              << (vertexFormat == VertexFormat::Packed ? "packed" : "float") << " vertices" << std::endl;
+    prepared.store(true, std::memory_order_release);
+}
+
+bool Model::Upload(double budgetMs) {
+    if (resident) return true;
+    if (!prepared.load(std::memory_order_acquire)) return false;
+    if (loader.joinable()) loader.join();
 
-    // Load textures
-    for (auto& [name, material] : materials) {
-        if (!material.diffuseTexture.empty()) {
-            std::string texturePath = "assets/" + material.diffuseTexture;
-            materialTextures[name] = TextureManager::LoadTexture(texturePath);
+    // Copy UploadChunkBytes at a time until the budget is spent; a group becomes
+    // drawable once both of its buffers are complete
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    while (nextGroup < stagedGroups.size()) {
+        const MeshCache::Group& group = stagedGroups[nextGroup];
+        const size_t vertexBytes = group.vertexCount * VertexLayout::Stride(vertexFormat);
+        const size_t indexBytes = group.indexCount * group.indexSize;
+        if (groupBytesUploaded == 0) beginGroup(group);
+
+        const ArenaAllocation& allocation = groupAllocations[group.materialId];
+        while (groupBytesUploaded < vertexBytes + indexBytes) {
+            const bool vertexStream = groupBytesUploaded < vertexBytes;
+            const size_t offset = vertexStream ? groupBytesUploaded : groupBytesUploaded - vertexBytes;
+            const size_t size = std::min(UploadChunkBytes, (vertexStream ? vertexBytes : indexBytes) - offset);
+            const char* source = static_cast<const char*>(vertexStream ? group.vertexData : group.indexData);
+            if (vertexStream) GeometryArena::WriteVertices(allocation, offset, size, source + offset);
+            else GeometryArena::WriteIndices(allocation, offset, size, source + offset);
+            groupBytesUploaded += size;
+            if (elapsedMs() >= budgetMs && groupBytesUploaded < vertexBytes + indexBytes) return false;
+        }
+        finishGroup(group);
+        ++nextGroup;
+        groupBytesUploaded = 0;
+        if (elapsedMs() >= budgetMs) return false;
+    }
+
+    // Textures go one per step, a full mip chain cannot be split
+    while (!stagedImages.empty()) {
+        auto& [id, image] = stagedImages.back();
+        materialTextures[id] = TextureManager::UploadImage(image);
+        if (materialTextures[id] != 0) {
+            gpuBytes += static_cast<size_t>(image.width) * image.height * (image.channels == 3 ? 3 : 4) * 4 / 3;  // with mips
+        }
+        TextureManager::FreeImage(image);
+        stagedImages.pop_back();
+        if (elapsedMs() >= budgetMs && !stagedImages.empty()) return false;
+    }
+
+    // Everything is on the GPU; the staged views (and the mapped cache) are no longer needed
+    std::vector<MeshCache::Group>().swap(stagedGroups);
+    std::vector<std::vector<uint8_t>>().swap(stagingStorage);
+    cache = MeshCache();
+    releaseCpuData();
+    resident = true;
+    return true;
+}
+
+void Model::encodeGroups(std::vector<MeshCache::Group>& groups, std::vector<std::vector<uint8_t>>& storage) {
+    for (uint32_t id = 0; id < materialVertexData.size(); ++id) {
+        const std::vector<float>& data = materialVertexData[id];
+        const std::vector<uint32_t>& indices = materialIndexData[id];
+        if (indices.empty()) continue;  // material without faces
+        const size_t vertexCount = data.size() / 8;
+        MeshCache::Group group{ id, data.data(), vertexCount, indices.data(), indices.size(), sizeof(uint32_t), groupLods[id], groupMeshlets[id] };
+        group.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        group.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (size_t i = 0; i < data.size(); i += 8) {
+            const glm::vec3 position(data[i], data[i + 1], data[i + 2]);
+            group.boundsMin = glm::min(group.boundsMin, position);
+            group.boundsMax = glm::max(group.boundsMax, position);
+        }
+
+        if (vertexFormat == VertexFormat::Packed) {
+            std::vector<uint8_t>& packed = storage.emplace_back(vertexCount * sizeof(PackedVertex));
+            VertexLayout::Pack(data.data(), vertexCount, boundsMin, boundsMax, reinterpret_cast<PackedVertex*>(packed.data()));
+            group.vertexData = packed.data();
         }
+        if (MeshCache::UseShortIndices(vertexCount)) {
+            std::vector<uint8_t>& narrowed = storage.emplace_back(indices.size() * sizeof(uint16_t));
+            std::copy(indices.begin(), indices.end(), reinterpret_cast<uint16_t*>(narrowed.data()));
+            group.indexData = narrowed.data();
+            group.indexSize = sizeof(uint16_t);
+        }
+        groups.push_back(group);
+    }
+}
+
+void Model::beginGroup(const MeshCache::Group& group) {
+    // Space is reserved up front and filled by Upload() in chunks
+    const size_t indexBytes = group.indexCount * group.indexSize;
+    groupAllocations[group.materialId] = GeometryArena::Allocate(vertexFormat, group.vertexCount, indexBytes);
+    gpuBytes += group.vertexCount * VertexLayout::Stride(vertexFormat) + indexBytes;
+}
+
+void Model::finishGroup(const MeshCache::Group& group) {
+    // drawGroups() walks groupLods, so this is what makes the group visible
+    const uint32_t id = group.materialId;
+    groupLods[id] = group.lods.empty() ? std::vector<LodLevel>{ { 0, static_cast<uint32_t>(group.indexCount), 0.0f } } : group.lods;
+    groupMeshlets[id] = group.meshlets;
+    groupBounds.set(id, group.boundsMin, group.boundsMax);
+    indexTypes[id] = (group.indexSize == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+glm::vec3 Model::stagedPosition(const MeshCache::Group& group, size_t vertex) const {
+    if (vertexFormat == VertexFormat::Packed) {
+        const PackedVertex& packed = static_cast<const PackedVertex*>(group.vertexData)[vertex];
+        const glm::vec3 unorm(packed.position[0], packed.position[1], packed.position[2]);
+        return positionOffset + unorm / 65535.0f * positionScale;
+    }
+    const float* v = static_cast<const float*>(group.vertexData) + vertex * 8;
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+uint32_t Model::stagedIndex(const MeshCache::Group& group, size_t index) const {
+    return (group.indexSize == sizeof(uint16_t)) ? static_cast<const uint16_t*>(group.indexData)[index]
+                                                 : static_cast<const uint32_t*>(group.indexData)[index];
+}
+
+void Model::buildPickBvh() {
+    // Built from the staged streams, so parsed and cached loads take the same
+    // path; packed positions are decoded back to model space
+    auto pickStart = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    pickGroupIds.clear();
+    pickGroupFirst.clear();
+    for (const MeshCache::Group& group : stagedGroups) {
+        const uint32_t baseVertex = static_cast<uint32_t>(positions.size());
+        pickGroupIds.push_back(group.materialId);
+        pickGroupFirst.push_back(static_cast<uint32_t>(indices.size() / 3));
+        for (size_t v = 0; v < group.vertexCount; ++v) positions.push_back(stagedPosition(group, v));
+        const size_t first = group.lods.empty() ? 0 : group.lods[0].indexOffset;
+        const size_t count = group.lods.empty() ? group.indexCount : group.lods[0].indexCount;
+        for (size_t i = first; i < first + count; ++i) indices.push_back(baseVertex + stagedIndex(group, i));
+    }
+    pickBvh.build(std::move(positions), indices);
+    std::chrono::duration<double, std::milli> pickTime = std::chrono::steady_clock::now() - pickStart;
+    std::cout << "Pick BVH: " << pickBvh.triangleCount() << " triangles in " << pickTime.count() << " ms, "
+              << pickBvh.memoryBytes() / 1024 << " KB" << std::endl;
+}
+
+void Model::buildOccluder() {
+    // Coarser levels collapse onto existing vertices, so numbering the vertices
+    // coarsest level first makes every level's vertex set a prefix
+    occluderPositions.clear();
+    occluderIndices.clear();
+    occluderGroups.clear();
+    std::vector<uint32_t> remap;
+    for (const MeshCache::Group& group : stagedGroups) {
+        OccluderGroup occluder;
+        occluder.firstVertex = static_cast<uint32_t>(occluderPositions.size());
+        occluder.lods = group.lods.empty() ? std::vector<LodLevel>{ { 0, static_cast<uint32_t>(group.indexCount), 0.0f } } : group.lods;
+        occluder.vertexCounts.resize(occluder.lods.size());
+        remap.assign(group.vertexCount, std::numeric_limits<uint32_t>::max());
+        uint32_t vertexCount = 0;
+        for (size_t level = occluder.lods.size(); level-- > 0;) {
+            LodLevel& lod = occluder.lods[level];
+            const size_t first = lod.indexOffset;
+            lod.indexOffset = static_cast<uint32_t>(occluderIndices.size());
+            for (size_t i = first; i < first + lod.indexCount; ++i) {
+                const uint32_t index = stagedIndex(group, i);
+                if (remap[index] == std::numeric_limits<uint32_t>::max()) {
+                    remap[index] = vertexCount++;
+                    occluderPositions.push_back(stagedPosition(group, index));
+                }
+                occluderIndices.push_back(remap[index]);
+            }
+            occluder.vertexCounts[level] = vertexCount;
+        }
+        occluderGroups.push_back(std::move(occluder));
+    }
+    occluderPositions.shrink_to_fit();
+    occluderIndices.shrink_to_fit();
+
+    glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+    for (const glm::vec3& p : occluderPositions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    occluderCenter = occluderPositions.empty() ? glm::vec3(0.0f) : (min + max) * 0.5f;
+    occluderRadius = occluderPositions.empty() ? 0.0f : glm::length(max - min) * 0.5f;
+    std::cout << "Occluder: " << occluderIndices.size() / 3 << " triangles over all levels, " << occluderPositions.size() << " vertices" << std::endl;
+}
+
+void Model::DrawOccluder(OcclusionCuller& culler, const glm::mat4& model, const Camera& camera, const glm::mat4& projection) const {
+    if (!prepared.load(std::memory_order_acquire) || occluderIndices.empty()) return;
+    // Same projection of the error as Draw, but onto the occlusion buffer's rows
+    const glm::vec3 center = glm::vec3(model * glm::vec4(occluderCenter, 1.0f));
+    const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+    const float distance = std::max(glm::length(center - camera.Position) - occluderRadius * scale, camera.NearPlane);
+    const float errorToPixels = scale * OcclusionCuller::Height * projection[1][1] * 0.5f / distance;
+    for (const OccluderGroup& group : occluderGroups) {
+        size_t level = 0;
+        while (level + 1 < group.lods.size() && group.lods[level + 1].error * errorToPixels <= OcclusionCuller::MaxOccluderPixelError) ++level;
+        const LodLevel& lod = group.lods[level];
+        culler.addOccluder(occluderPositions.data() + group.firstVertex, group.vertexCounts[level], occluderIndices.data() + lod.indexOffset,
+                           lod.indexCount, model);
+    }
+}
+
+bool Model::Pick(const glm::mat4& model, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, PickHit& hit) const {
+    if (!prepared.load(std::memory_order_acquire) || pickBvh.empty()) return false;
+    // An affine transform keeps the ray parameter, so distances need no conversion back
+    const glm::mat4 toModel = glm::inverse(model);
+    TriangleBvh::Hit triangleHit;
+    if (!pickBvh.intersect(glm::vec3(toModel * glm::vec4(origin, 1.0f)), glm::vec3(toModel * glm::vec4(direction, 0.0f)), maxDistance, triangleHit)) {
+        return false;
+    }
+    const size_t group = std::upper_bound(pickGroupFirst.begin(), pickGroupFirst.end(), triangleHit.triangle) - pickGroupFirst.begin() - 1;
+    hit = { pickGroupIds[group], triangleHit.triangle - pickGroupFirst[group], triangleHit.distance, glm::vec2(triangleHit.u, triangleHit.v) };
+    return true;
+}
+
+bool Model::Occludes(const glm::mat4& model, const glm::vec3& from, const glm::vec3& to) const {
+    if (!prepared.load(std::memory_order_acquire) || pickBvh.empty()) return false;
+    const glm::mat4 toModel = glm::inverse(model);
+    const glm::vec3 start = glm::vec3(toModel * glm::vec4(from, 1.0f));
+    return pickBvh.occluded(start, glm::vec3(toModel * glm::vec4(to, 1.0f)) - start, 1.0f);
+}
+
+void Model::releaseCpuData() {
+    if (retention == RetentionPolicy::KeepAll) return;
+    objData = ObjData();
+    std::vector<std::vector<float>>().swap(materialVertexData);
+    std::vector<std::vector<uint32_t>>().swap(materialIndexData);
+    if (retention == RetentionPolicy::KeepNothing) {
+        for (std::vector<Meshlet>& meshlets : groupMeshlets) std::vector<Meshlet>().swap(meshlets);
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        groupBounds = AabbList();
+        hasBounds = false;
     }
+}
 
-    // Create VAOs/VBOs
-    for (const auto& [name, data] : materialVertexData) {
-        GLuint VAO, VBO;
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
+namespace {
 
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+template <typename T>
+size_t capacityBytes(const std::vector<T>& v) { return v.capacity() * sizeof(T); }
+
+template <typename T>
+size_t capacityBytes(const std::vector<std::vector<T>>& v) {
+    size_t bytes = capacityBytes<std::vector<T>>(v);
+    for (const std::vector<T>& inner : v) bytes += capacityBytes(inner);
+    return bytes;
+}
 
-        // Vertex positions
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        // Texture coordinates
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        // Normals
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-        glEnableVertexAttribArray(2);
+} // namespace
 
-        glBindVertexArray(0);
-        VAOs[name] = VAO;
-        VBOs[name] = VBO;
+ModelMemory Model::getResidentBytes() const {
+    if (!prepared.load(std::memory_order_acquire)) return { 0, 0 };
+    size_t cpu = capacityBytes(objData.vertices) + capacityBytes(objData.texCoords) + capacityBytes(objData.normals) +
+                 capacityBytes(objData.faceVertices) + capacityBytes(objData.faceTexCoords) + capacityBytes(objData.faceNormals) +
+                 capacityBytes(objData.materialFaceStart) + capacityBytes(materialVertexData) + capacityBytes(materialIndexData) +
+                 capacityBytes(groupLods) + capacityBytes(groupMeshlets) + capacityBytes(stagingStorage) + cache.mappedBytes() +
+                 groupBounds.size() * 6 * sizeof(float) + pickBvh.memoryBytes() +
+                 capacityBytes(occluderPositions) + capacityBytes(occluderIndices) + capacityBytes(occluderGroups);
+    for (const OccluderGroup& group : occluderGroups) cpu += capacityBytes(group.lods) + capacityBytes(group.vertexCounts);
+    for (const auto& [id, image] : stagedImages) {
+        if (image.pixels) cpu += static_cast<size_t>(image.width) * image.height * image.channels;
     }
+    return { cpu, gpuBytes };
 }
 
 Model::~Model() {
+    // A progressive load may still be parsing
+    if (loader.joinable()) loader.join();
+    for (auto& [id, image] : stagedImages) {
+        TextureManager::FreeImage(image);
+    }
+
     // Cleanup textures
-    for (auto& [name, textureID] : materialTextures) {
-        TextureManager::DeleteTexture(textureID);
+    for (GLuint textureID : materialTextures) {
+        if (textureID != 0) TextureManager::DeleteTexture(textureID);
+    }
+
+    if (materialBuffer != 0) glDeleteBuffers(1, &materialBuffer);
+
+    // Return the geometry to the arena; groups that never uploaded hold empty ranges
+    for (const ArenaAllocation& allocation : groupAllocations) {
+        GeometryArena::Free(allocation);
     }
-    
-    // Cleanup VAOs/VBOs
-    for (auto& [name, VAO] : VAOs) {
-        glDeleteVertexArrays(1, &VAO);
+}
+
+void Model::Draw(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model) {
+    if (!prepared.load(std::memory_order_acquire)) return;
+    drawGroups(queue, shaders, model, 0.0f, std::numeric_limits<float>::infinity(), nullptr, glm::vec3(0.0f));
+}
+
+void Model::Draw(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, const Camera& camera, const glm::mat4& projection, float viewportHeight) {
+    if (!prepared.load(std::memory_order_acquire)) return;  // bounds and materials are still being written
+    if (!hasBounds) {
+        drawGroups(queue, shaders, model, 0.0f, std::numeric_limits<float>::infinity(), nullptr, glm::vec3(0.0f));
+        return;
     }
-    for (auto& [name, VBO] : VBOs) {
-        glDeleteBuffers(1, &VBO);
+    // Project the model's bounding sphere: a model-space error e covers roughly
+    // e * scale * pixelsPerUnit / distance pixels on screen
+    const glm::vec3 center = glm::vec3(model * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+    const float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+    const float distance = std::max(glm::length(center - camera.Position) - radius, camera.NearPlane);
+    const float pixelsPerUnit = viewportHeight * projection[1][1] * 0.5f;  // projection[1][1] = 1 / tan(fovY / 2)
+
+    // Meshlet bounds are in model space, so bring the frustum and camera there
+    const Frustum frustum = Frustum::FromMatrix(projection * camera.GetViewMatrix() * model);
+    const glm::vec3 cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(camera.Position, 1.0f));
+    drawGroups(queue, shaders, model, distance, scale * pixelsPerUnit / distance, &frustum, cameraPosition);
+}
+
+bool Model::getBounds(glm::vec3& min, glm::vec3& max) const {
+    min = boundsMin;
+    max = boundsMax;
+    return hasBounds;
+}
+
+uint32_t Model::shaderVariant(uint32_t id, uint32_t lightCount) const {
+    uint32_t features = 0;
+    if (materialTextures[id] != 0) features |= ShaderTextured;
+    const Material& material = materials[id];
+    if (material.Ks[0] > 0.0f || material.Ks[1] > 0.0f || material.Ks[2] > 0.0f) features |= ShaderSpecular;
+    if (vertexFormat == VertexFormat::Packed) features |= ShaderPackedVertices;
+    return ShaderVariants::Key(features, lightCount);
+}
+
+void Model::writeMaterialBuffer() {
+    // Per-draw material data, indexed by the command's baseInstance; it never changes.
+    // Material ID id sits at entry id % MaxDrawMaterials of block id / MaxDrawMaterials;
+    // a block is 4 KB, a multiple of every GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT in use.
+    const size_t blockCount = std::max<size_t>(1, (materials.size() + GeometryArena::MaxDrawMaterials - 1) / GeometryArena::MaxDrawMaterials);
+    std::vector<MaterialUniforms> palette(blockCount, MaterialUniforms{});
+    for (size_t id = 0; id < materials.size(); ++id) {
+        const Material& material = materials[id];
+        MaterialUniforms& block = palette[id / GeometryArena::MaxDrawMaterials];
+        block.diffuse[id % GeometryArena::MaxDrawMaterials] = glm::vec4(material.Kd[0], material.Kd[1], material.Kd[2], 1.0f);
+        block.specular[id % GeometryArena::MaxDrawMaterials] = glm::vec4(material.Ks[0], material.Ks[1], material.Ks[2], material.shininess());
     }
+    glGenBuffers(1, &materialBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, palette.size() * sizeof(MaterialUniforms), palette.data(), GL_STATIC_DRAW);
+    gpuBytes += palette.size() * sizeof(MaterialUniforms);
 }
 
-void Model::Draw(Shader& shader) {
-    shader.use();
-    for (const auto& [name, data] : materialVertexData) {
-        const auto& material = materials[name];
-        GLuint textureID = materialTextures[name];
+void Model::DrawInstanced(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, const InstanceBuffer& instances, int level) {
+    if (!prepared.load(std::memory_order_acquire) || instances.size() == 0) return;
+    if (materialBuffer == 0) writeMaterialBuffer();
 
-        // Set material properties
-        shader.setVec3("material.ambient", glm::vec3(material.Ka[0], material.Ka[1], material.Ka[2]));
-        shader.setVec3("material.diffuse", glm::vec3(material.Kd[0], material.Kd[1], material.Kd[2]));
-        shader.setVec3("material.specular", glm::vec3(material.Ks[0], material.Ks[1], material.Ks[2]));
-        shader.setFloat("material.shininess", 32.0f);
+    DrawState state;
+    state.materialBuffer = materialBuffer;
+    state.instanceTexture = instances.texture();
+    state.format = vertexFormat;
+    const uint32_t lightCount = std::min(UniformBuffers::CurrentFrame().lightCount, UniformBuffers::MaxLights);
 
-        // Bind texture if available
-        if (textureID != 0) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            shader.setInt("diffuseMap", 0);
-        }
+    // The material index cannot ride on baseInstance here, so every group
+    // gets its own object block and a single instanced command
+    for (uint32_t id = 0; id < groupLods.size(); ++id) {
+        const std::vector<LodLevel>& lods = groupLods[id];
+        if (lods.empty()) continue;  // not resident (yet), or no faces
+        const uint32_t variant = shaderVariant(id, lightCount) | ShaderInstanced;
+        Shader* shader = shaders.ready(variant);
+        if (!shader) shader = shaders.ready(variant | ShaderTextured | ShaderSpecular);
+        if (!shader) continue;
 
-        // Draw mesh
-        glBindVertexArray(VAOs[name]);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(data.size() / 8));
-        glBindVertexArray(0);
+        const LodLevel& lod = lods[std::min<size_t>(std::max(level, 0), lods.size() - 1)];
+        const size_t indexSize = (indexTypes[id] == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+        const ArenaAllocation& allocation = groupAllocations[id];
+        const uint32_t materialIndex = id % GeometryArena::MaxDrawMaterials;
+        const DrawCommand command{ lod.indexCount, static_cast<uint32_t>(instances.size()),
+                                   allocation.firstIndex(indexSize) + lod.indexOffset, allocation.baseVertex(), 0 };
+
+        state.program = shader->ID;
+        state.texture = materialTextures[id];
+        state.materialOffset = (id / GeometryArena::MaxDrawMaterials) * sizeof(MaterialUniforms);
+        state.objectOffset = UniformBuffers::WriteObject(model, positionOffset, positionScale, materialIndex);
+        state.page = allocation.page;
+        state.indexType = indexTypes[id];
+        queue.add(state, &command, 1, 0.0f);
     }
 }
 
-void Model::loadOBJ(const std::string& filepath) {
-    std::ifstream file(filepath);
-    std::string line, currentMaterial;
+void Model::drawGroups(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, float depth,
+                       float errorToPixels, const Frustum* frustum, const glm::vec3& cameraPosition) {
+    if (materialBuffer == 0) writeMaterialBuffer();
 
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type;
-        iss >> type;
+    DrawState state;
+    state.materialBuffer = materialBuffer;
+    // Object block: transform plus the vertex format decode (identity for float vertices)
+    state.objectOffset = UniformBuffers::WriteObject(model, positionOffset, positionScale);
+    state.format = vertexFormat;
+    const uint32_t lightCount = std::min(UniformBuffers::CurrentFrame().lightCount, UniformBuffers::MaxLights);
 
-        if (type == "v") {
-            Vertex v;
-            iss >> v.x >> v.y >> v.z;
-            vertices.push_back(v);
-        }
-        else if (type == "vt") {
-            TexCoord vt;
-            iss >> vt.u >> vt.v;
-            texCoords.push_back(vt);
-        }
-        else if (type == "vn") {
-            Normal vn;
-            iss >> vn.x >> vn.y >> vn.z;
-            normals.push_back(vn);
-        }
-        else if (type == "usemtl") {
-            iss >> currentMaterial;
+    // Commands are batched by shader variant, arena page, material block, index type and texture; each batch is one multi-draw
+    for (DrawBatch& batch : drawBatches) batch.commands.clear();
+    auto batchFor = [this](uint32_t variant, uint32_t page, uint32_t materialPage, GLenum indexType, GLuint texture) -> std::vector<DrawCommand>& {
+        for (DrawBatch& batch : drawBatches) {
+            if (batch.variant == variant && batch.page == page && batch.materialPage == materialPage && batch.indexType == indexType &&
+                batch.texture == texture) {
+                return batch.commands;
+            }
         }
-        else if (type == "f") {
-            Face face;
-            for (int i = 0; i < 3; ++i) {
-                std::string vertexData;
-                iss >> vertexData;
-                std::replace(vertexData.begin(), vertexData.end(), '/', ' ');
-                std::istringstream vStream(vertexData);
-
-                int v, vt, vn;
-                vStream >> v >> vt >> vn;
-                face.vertexIndices[i] = v - 1;
-                face.texCoordIndices[i] = vt - 1;
-                face.normalIndices[i] = vn - 1;
+        drawBatches.push_back({ variant, page, materialPage, indexType, texture, {} });
+        return drawBatches.back().commands;
+    };
+
+    // Groups entirely outside the frustum are dropped before LOD selection and meshlet culling
+    size_t groupCount = groupLods.size();
+    visibleGroups.resize(groupCount);
+    if (frustum) groupCount = FrustumCuller::Cull(*frustum, groupBounds, visibleGroups.data());
+    else for (uint32_t id = 0; id < groupCount; ++id) visibleGroups[id] = id;
+
+    meshletStats = { 0, 0 };
+    for (size_t visible = 0; visible < groupCount; ++visible) {
+        const uint32_t id = visibleGroups[visible];
+        const std::vector<LodLevel>& lods = groupLods[id];
+        if (lods.empty()) continue;  // not resident (yet), or no faces
+
+        // Coarsest level that is still below the pixel error budget; errors grow with the level
+        size_t level = 0;
+        while (level + 1 < lods.size() && lods[level + 1].error * errorToPixels <= lodPixelError) ++level;
+        const LodLevel& lod = lods[level];
+        const GLenum indexType = indexTypes[id];
+        const size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+        const ArenaAllocation& allocation = groupAllocations[id];
+        const uint32_t firstIndex = allocation.firstIndex(indexSize);
+        const uint32_t materialIndex = id % GeometryArena::MaxDrawMaterials;
+        std::vector<DrawCommand>& commands =
+            batchFor(shaderVariant(id, lightCount), allocation.page, id / GeometryArena::MaxDrawMaterials, indexType, materialTextures[id]);
+
+        // At full detail only the meshlets that survive culling are drawn
+        const std::vector<Meshlet>& meshlets = groupMeshlets[id];
+        if (frustum && level == 0 && !meshlets.empty()) {
+            const size_t firstCommand = commands.size();
+            for (const Meshlet& meshlet : meshlets) {
+                if (!MeshletBuilder::IsVisible(meshlet, *frustum, cameraPosition)) continue;
+                // Adjacent survivors merge into one command
+                const uint32_t start = firstIndex + meshlet.indexOffset;
+                if (commands.size() > firstCommand && commands.back().firstIndex + commands.back().count == start) {
+                    commands.back().count += meshlet.indexCount;
+                } else {
+                    commands.push_back({ meshlet.indexCount, 1, start, allocation.baseVertex(), materialIndex });
+                }
+                ++meshletStats.visible;
             }
-            face.materialName = currentMaterial;
-            faces.push_back(face);
+            meshletStats.tested += meshlets.size();
+        } else {
+            commands.push_back({ lod.indexCount, 1, firstIndex + lod.indexOffset, allocation.baseVertex(), materialIndex });
         }
     }
+
+    // One packet per batch; the queue orders them and drops repeated binds
+    for (const DrawBatch& batch : drawBatches) {
+        if (batch.commands.empty()) continue;
+        // A variant still compiling is stood in for by the full-featured one
+        Shader* shader = shaders.ready(batch.variant);
+        if (!shader) shader = shaders.ready(batch.variant | ShaderTextured | ShaderSpecular);
+        if (!shader) continue;
+        state.program = shader->ID;
+        state.texture = batch.texture;  // untextured variants sample nothing
+        state.page = batch.page;
+        state.materialOffset = batch.materialPage * sizeof(MaterialUniforms);
+        state.indexType = batch.indexType;
+        queue.add(state, batch.commands.data(), batch.commands.size(), depth);
+    }
+}
+
+void Model::loadOBJ(const MappedFile& file) {
+    ObjParser::ParseOBJ(file.data(), file.size(), objData);
+}
+
+void Model::loadMTL(const MappedFile& file) {
+    // Only materials the OBJ uses get an ID; one missing from the MTL keeps zero colors
+    std::map<std::string, Material> library;
+    ObjParser::ParseMTL(file.data(), file.size(), library);
+    materials.resize(objData.materialNames.size());
+    for (size_t id = 0; id < materials.size(); ++id) {
+        auto it = library.find(objData.materialNames[id]);
+        materials[id] = (it != library.end()) ? it->second : Material{};
+        materials[id].name = objData.materialNames[id];
+    }
 }
 
-void Model::loadMTL(const std::string& filepath) {
-    std::ifstream file(filepath);
-    std::string line;
-    Material currentMaterial;
+void Model::processVertexData() {
+    // Deduplicate corners per material group so shared vertices are stored
+    // (and transformed) once, then referenced from the index buffer
+    MeshBuilder::Assemble(objData, materialVertexData, materialIndexData);
 
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type;
-        iss >> type;
+    // Report what indexing saved compared to one vertex per corner
+    size_t corners = objData.faceVertices.size(), uniqueVertices = 0, indexedBytes = 0;
+    for (size_t id = 0; id < materialVertexData.size(); ++id) {
+        const size_t count = materialVertexData[id].size() / 8;
+        uniqueVertices += count;
+        indexedBytes += materialVertexData[id].size() * sizeof(float) +
+                        materialIndexData[id].size() * (MeshCache::UseShortIndices(count) ? sizeof(uint16_t) : sizeof(uint32_t));
+    }
+    if (corners > 0) {
+        std::cout << "Indexed " << corners << " corners into " << uniqueVertices << " unique vertices ("
+                  << static_cast<double>(corners) / std::max<size_t>(uniqueVertices, 1) << "x reuse): vertex memory "
+                  << corners * 8 * sizeof(float) / 1024 << " KB -> " << indexedBytes / 1024 << " KB, vertex shader invocations "
+                  << corners << " -> at most " << uniqueVertices << std::endl;
+    }
 
-        if (type == "newmtl") {
-            if (!currentMaterial.name.empty()) {
-                materials[currentMaterial.name] = currentMaterial;
+    // Bounds of every vertex referenced by a face, i.e. of the unique vertices
+    if (corners > 0) {
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const std::vector<float>& data : materialVertexData) {
+            for (size_t i = 0; i < data.size(); i += 8) {
+                const glm::vec3 position(data[i], data[i + 1], data[i + 2]);
+                boundsMin = glm::min(boundsMin, position);
+                boundsMax = glm::max(boundsMax, position);
             }
-            currentMaterial = Material();
-            iss >> currentMaterial.name;
-        }
-        else if (type == "Ka") {
-            iss >> currentMaterial.Ka[0] >> currentMaterial.Ka[1] >> currentMaterial.Ka[2];
-        }
-        else if (type == "Kd") {
-            iss >> currentMaterial.Kd[0] >> currentMaterial.Kd[1] >> currentMaterial.Kd[2];
-        }
-        else if (type == "Ks") {
-            iss >> currentMaterial.Ks[0] >> currentMaterial.Ks[1] >> currentMaterial.Ks[2];
-        }
-        else if (type == "map_Kd") {
-            iss >> currentMaterial.diffuseTexture;
         }
     }
-    if (!currentMaterial.name.empty()) {
-        materials[currentMaterial.name] = currentMaterial;
+}
+
+void Model::optimizeMesh() {
+    for (size_t id = 0; id < materialVertexData.size(); ++id) {
+        std::vector<float>& data = materialVertexData[id];
+        std::vector<uint32_t>& indices = materialIndexData[id];
+        if (indices.empty()) continue;
+        const size_t vertexCount = data.size() / 8;
+        const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+        MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), data.data(), 8, vertexCount);
+        MeshOptimizer::OptimizeVertexFetch(data.data(), 8, indices.data(), indices.size(), vertexCount);
+
+        const VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+        std::cout << "Optimized " << materials[id].name << ": ACMR " << before.acmr << " -> " << after.acmr
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
     }
 }
 
-void Model::processVertexData() {
-    for (const Face& face : faces) {
-        const std::string& matName = face.materialName;
-        for (int i = 0; i < 3; ++i) {
-            const Vertex& v = vertices[face.vertexIndices[i]];
-            const TexCoord& t = texCoords[face.texCoordIndices[i]];
-            const Normal& n = normals[face.normalIndices[i]];
-
-            materialVertexData[matName].insert(materialVertexData[matName].end(), {
-                v.x, v.y, v.z,        // Position
-                t.u, t.v,             // Texture coordinates
-                n.x, n.y, n.z         // Normal
-            });
+void Model::buildMeshlets() {
+    size_t total = 0;
+    groupMeshlets.assign(materialVertexData.size(), {});
+    for (size_t id = 0; id < materialVertexData.size(); ++id) {
+        const std::vector<float>& data = materialVertexData[id];
+        const std::vector<uint32_t>& indices = materialIndexData[id];
+        groupMeshlets[id] = MeshletBuilder::Build(indices.data(), indices.size(), data.data(), 8, data.size() / 8);
+        total += groupMeshlets[id].size();
+    }
+    std::cout << "Built " << total << " meshlets" << std::endl;
+}
+
+void Model::generateLods(int lodCount) {
+    groupLods.assign(materialVertexData.size(), {});
+    for (size_t id = 0; id < materialVertexData.size(); ++id) {
+        const std::vector<float>& data = materialVertexData[id];
+        std::vector<uint32_t>& indices = materialIndexData[id];
+        if (indices.empty()) continue;
+        std::vector<LodLevel>& lods = groupLods[id];
+        lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+
+        // Each level halves the previous one; the simplified lists are appended
+        // to the same index buffer so all levels share the group's vertices
+        const size_t vertexCount = data.size() / 8;
+        std::vector<uint32_t> previous(indices), simplified(indices.size());
+        for (int level = 1; level <= lodCount; ++level) {
+            float error = 0.0f;
+            const size_t target = previous.size() / 6 * 3;
+            const size_t count = MeshSimplifier::Simplify(simplified.data(), previous.data(), previous.size(),
+                                                          data.data(), 8, vertexCount, target, error);
+            if (count == 0 || count > previous.size() * 9 / 10) break;  // the mesh will not get meaningfully coarser
+            MeshOptimizer::OptimizeVertexCache(simplified.data(), count, vertexCount);
+
+            // Levels are simplified from each other, so their errors add up
+            lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(count), lods.back().error + error });
+            indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+            previous.assign(simplified.begin(), simplified.begin() + count);
         }
+
+        std::cout << "LODs for " << materials[id].name << ":";
+        for (const LodLevel& lod : lods) std::cout << " " << lod.indexCount / 3 << " tris (error " << lod.error << ")";
+        std::cout << std::endl;
     }
 }
\ No newline at end of file
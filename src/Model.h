@@ -4,54 +4,200 @@
 #include <GL/glew.h>
 #include <vector>
 #include <string>
+#include <cstdint>
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "Camera.h"
+#include "Meshlet.h"
+#include "Texture.h"
+#include "GeometryArena.h"
+#include "FrustumCulling.h"
+#include "TriangleBvh.h"
+#include "OcclusionCuller.h"
+#include <atomic>
+#include <thread>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
 #include <algorithm>  
 
-// Structs to hold OBJ data
+struct MeshletStats {
+    size_t tested;
+    size_t visible;
+};
+
+// What a Model keeps in system memory once everything is on the GPU
+enum class RetentionPolicy {
+    KeepAll,     // parsed OBJ and assembled vertex/index streams, e.g. for CPU-side processing
+    KeepBounds,  // bounds, LOD ranges and meshlets only; LOD selection and culling keep working
+    KeepNothing  // draw state only; Draw always renders every group at full detail, unculled
+};
 
-struct Vertex { float x, y, z; };
-struct TexCoord { float u, v; };
-struct Normal { float x, y, z; };
+// Bytes held by one Model
+struct ModelMemory {
+    size_t cpuBytes;  // heap and mapped data owned by the model
+    size_t gpuBytes;  // buffers and textures it uploaded
+};
 
-struct Face {
-    int vertexIndices[3];
-    int texCoordIndices[3];
-    int normalIndices[3];
-    std::string materialName;
+// Closest triangle found by Model::Pick
+struct PickHit {
+    uint32_t materialId;     // material group
+    uint32_t triangle;       // in the group's full-detail index range: indices 3 * triangle .. + 2
+    float distance;          // along the ray, in units of its direction
+    glm::vec2 barycentric;   // weights of the triangle's second and third corner
 };
 
-struct Material {
-    std::string name;
-    float Ka[3]; // Ambient
-    float Kd[3]; // Diffuse
-    float Ks[3]; // Specular
-    std::string diffuseTexture;
+// Load-time settings for Model
+struct ModelOptions {
+    // Reorder each material group for the vertex cache, overdraw and vertex fetch after indexing
+    bool optimizeMesh = true;
+    // Float32 uploads 32 bytes per vertex, Packed 16 (quantized position, half UV, octahedral normal)
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    // Simplified levels generated per material group below the full-detail one
+    int lodCount = 4;
+    // Split full-detail groups into meshlets that are frustum and back-face culled on the CPU
+    bool buildMeshlets = true;
+    // Screen-space error (pixels) a level may introduce before a finer one is drawn
+    float lodPixelError = 1.0f;
+    // Parse on a background thread and leave the GPU upload to Model::Upload calls
+    // from the render loop, instead of blocking in the constructor
+    bool progressive = false;
+    // CPU copies released once the upload finishes
+    RetentionPolicy retention = RetentionPolicy::KeepBounds;
+    // Build a triangle BVH of the full-detail mesh for Pick and Occludes; it is
+    // kept under every retention policy
+    bool buildPickBvh = false;
+    // Keep the positions and every level of each group as an occluder mesh for DrawOccluder;
+    // kept under every retention policy
+    bool buildOccluder = false;
 };
 
 class Model {
 private:
-    std::vector<Vertex> vertices;
-    std::vector<TexCoord> texCoords;
-    std::vector<Normal> normals;
-    std::vector<Face> faces;
-    std::map<std::string, Material> materials;
-    std::map<std::string, std::vector<float>> materialVertexData;
-    std::map<std::string, GLuint> VAOs;
-    std::map<std::string, GLuint> VBOs;
-    std::map<std::string, GLuint> materialTextures;
-
-    void loadOBJ(const std::string& filepath);
-    void loadMTL(const std::string& filepath);
+    ObjData objData;                 // parsed OBJ, faces grouped by material ID
+    // Everything below is indexed by material ID (see ObjData::materialNames)
+    std::vector<Material> materials;
+    std::vector<std::vector<float>> materialVertexData;     // unique vertices, 8 floats each
+    std::vector<std::vector<uint32_t>> materialIndexData;   // triangle list into materialVertexData
+    std::vector<ArenaAllocation> groupAllocations;  // where each group lives in the GeometryArena
+    std::vector<GLuint> materialTextures;
+    std::vector<std::vector<LodLevel>> groupLods;     // ranges of the group's index buffer, finest first; empty until resident
+    std::vector<std::vector<Meshlet>> groupMeshlets;  // partition of the level 0 range
+    AabbList groupBounds;                             // model space, zero until resident
+    TriangleBvh pickBvh;                              // full detail, all groups in stagedGroups order
+    std::vector<uint32_t> pickGroupIds, pickGroupFirst;  // material and first BVH triangle of each group
+    // Occluder mesh, every level of every group. A group's vertices are ordered
+    // coarsest level first, so each level only uses a prefix of them.
+    struct OccluderGroup {
+        uint32_t firstVertex;                // in occluderPositions
+        std::vector<LodLevel> lods;          // ranges of occluderIndices, finest first
+        std::vector<uint32_t> vertexCounts;  // prefix each level uses
+    };
+    std::vector<glm::vec3> occluderPositions;         // model space
+    std::vector<uint32_t> occluderIndices;            // group-local vertex numbers
+    std::vector<OccluderGroup> occluderGroups;
+    glm::vec3 occluderCenter{ 0.0f };                 // bounding sphere, kept under every retention policy
+    float occluderRadius = 0.0f;
+    std::vector<GLenum> indexTypes;
+    glm::vec3 boundsMin{ 0.0f }, boundsMax{ 0.0f };
+    bool hasBounds = true;                       // false once released by RetentionPolicy::KeepNothing
+    glm::vec3 positionOffset{ 0.0f }, positionScale{ 1.0f };  // vertex format decode, see VertexLayout
+    RetentionPolicy retention = RetentionPolicy::KeepBounds;
+    size_t gpuBytes = 0;
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    float lodPixelError = 1.0f;
+    MeshletStats meshletStats{ 0, 0 };
+
+    // Per-frame scratch for drawGroups
+    struct DrawBatch {
+        uint32_t variant;  // ShaderVariants key
+        uint32_t page;
+        uint32_t materialPage;  // MaterialUniforms block, material ID / MaxDrawMaterials
+        GLenum indexType;
+        GLuint texture;
+        std::vector<DrawCommand> commands;
+    };
+    std::vector<DrawBatch> drawBatches;
+    std::vector<uint32_t> visibleGroups;
+    GLuint materialBuffer = 0;  // Materials block, written on the first draw
+
+    // Load state: prepare() fills the staged data, Upload() moves it to the GPU
+    std::thread loader;
+    std::atomic<bool> prepared{ false };
+    bool resident = false;
+    MeshCache cache;
+    std::vector<MeshCache::Group> stagedGroups;
+    std::vector<std::vector<uint8_t>> stagingStorage;
+    std::vector<std::pair<uint32_t, ImageData>> stagedImages;
+    size_t nextGroup = 0;            // first group not yet fully uploaded
+    size_t groupBytesUploaded = 0;   // progress inside it, vertex bytes then index bytes
+
+    void loadOBJ(const MappedFile& file);
+    void loadMTL(const MappedFile& file);
     void processVertexData();
+    void optimizeMesh();
+    void buildMeshlets();
+    void generateLods(int lodCount);
+    void prepare(const std::string& objPath, const std::string& mtlPath, const ModelOptions& options);
+    void encodeGroups(std::vector<MeshCache::Group>& groups, std::vector<std::vector<uint8_t>>& storage);
+    void beginGroup(const MeshCache::Group& group);
+    void finishGroup(const MeshCache::Group& group);
+    glm::vec3 stagedPosition(const MeshCache::Group& group, size_t vertex) const;
+    uint32_t stagedIndex(const MeshCache::Group& group, size_t index) const;
+    void buildPickBvh();
+    void buildOccluder();
+    void releaseCpuData();
+    uint32_t shaderVariant(uint32_t id, uint32_t lightCount) const;
+    void writeMaterialBuffer();
+    void drawGroups(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, float depth,
+                    float errorToPixels, const Frustum* frustum, const glm::vec3& cameraPosition);
 
 public:
-    Model(const std::string& objPath, const std::string& mtlPath);
+    Model(const std::string& objPath, const std::string& mtlPath, const ModelOptions& options = ModelOptions());
     ~Model();
-    void Draw(Shader& shader);
+    // Uploads staged geometry and textures until budgetMs has passed. Returns true
+    // once everything is resident; until then Draw shows the groups finished so far.
+    bool Upload(double budgetMs);
+    bool isResident() const { return resident; }
+    // Memory currently held; zero until a progressive load has been parsed
+    ModelMemory getResidentBytes() const;
+    // Largest single glBufferSubData issued by Upload
+    static constexpr size_t UploadChunkBytes = 1 << 20;
+
+    // Queues every group at full detail. Each material uses the cheapest variant
+    // of shaders that covers it (see shaderVariant); until that has compiled the
+    // textured, specular one stands in, and groups with neither ready are skipped.
+    void Draw(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model);
+    // Draws each group at the coarsest level whose projected error stays below
+    // ModelOptions::lodPixelError; at full detail only meshlets that are inside
+    // the frustum and not back-facing are queued
+    void Draw(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, const Camera& camera, const glm::mat4& projection, float viewportHeight);
+    // Queues one instanced draw per material group covering every instance,
+    // each placed by its transform after model. level picks the LOD (clamped
+    // per group); instances are neither LOD-selected nor culled individually.
+    void DrawInstanced(RenderQueue& queue, ShaderVariants& shaders, const glm::mat4& model, const InstanceBuffer& instances, int level = 0);
+    // Closest triangle hit by a world-space ray, for a model drawn with the
+    // given transform. Needs ModelOptions::buildPickBvh; false on a miss.
+    bool Pick(const glm::mat4& model, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, PickHit& hit) const;
+    // Whether any triangle lies on the segment between two world-space points
+    bool Occludes(const glm::mat4& model, const glm::vec3& from, const glm::vec3& to) const;
+    // Queues the occluder mesh with culler. Needs ModelOptions::buildOccluder.
+    // Simplified levels are not inside the real surface, so each group uses the
+    // coarsest level whose error stays below OcclusionCuller::MaxOccluderPixelError
+    // buffer pixels at the model's nearest point; up close that is full detail.
+    void DrawOccluder(OcclusionCuller& culler, const glm::mat4& model, const Camera& camera, const glm::mat4& projection) const;
+    // Model-space bounds of all groups; false once released by RetentionPolicy::KeepNothing
+    bool getBounds(glm::vec3& min, glm::vec3& max) const;
+    // Meshlets tested and drawn by the last Draw call
+    const MeshletStats& getMeshletStats() const { return meshletStats; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,402 @@
+#include "ObjParser.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline void skipBlanks(const char*& p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+}
+
+// Moves p to the first character of the next line
+inline void skipLine(const char*& p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    p = nl ? static_cast<const char*>(nl) + 1 : end;
+}
+
+// Matches a keyword followed by whitespace and advances past it
+inline bool matchKeyword(const char*& p, const char* end, const char* keyword, size_t length) {
+    if (static_cast<size_t>(end - p) <= length || std::memcmp(p, keyword, length) != 0 || !isBlank(p[length]))
+        return false;
+    p += length;
+    return true;
+}
+
+inline float parseFloat(const char*& p, const char* end) {
+    skipBlanks(p, end);
+    if (p < end && *p == '+') ++p;  // from_chars does not accept a leading '+'
+    float value = 0.0f;
+    auto result = std::from_chars(p, end, value);
+    p = result.ptr;
+    return value;
+}
+
+inline bool parseInt(const char*& p, const char* end, int& value) {
+    if (p < end && *p == '+') ++p;
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to a 0-based one.
+// 0 is not an OBJ index; it maps to a value no range check accepts.
+inline int resolveIndex(int index, size_t count) {
+    if (index == 0) return std::numeric_limits<int>::min();
+    return index < 0 ? static_cast<int>(count) + index : index - 1;
+}
+
+// Returns the next whitespace-delimited token on the current line
+inline std::string_view parseToken(const char*& p, const char* end) {
+    skipBlanks(p, end);
+    const char* tokenEnd = p;
+    while (tokenEnd < end && !isBlank(*tokenEnd) && *tokenEnd != '\n') ++tokenEnd;
+    std::string_view token(p, static_cast<size_t>(tokenEnd - p));
+    p = tokenEnd;
+    return token;
+}
+
+inline void parseColor(const char*& p, const char* end, float (&color)[3]) {
+    for (float& c : color) c = parseFloat(p, end);
+}
+
+struct Corner { int v, vt, vn; };
+
+// Material ID of faces seen before any usemtl in a chunk, resolved at merge time
+constexpr uint32_t NoMaterial = ~0u;
+
+// Returns the ID of name in the material table, adding it on first use.
+// Files have a handful of materials, so a linear scan beats hashing here.
+uint32_t internMaterial(std::vector<std::string>& names, std::string_view name) {
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) return static_cast<uint32_t>(i);
+    }
+    names.emplace_back(name);
+    return static_cast<uint32_t>(names.size() - 1);
+}
+
+// A negative (relative) index resolved against a chunk's local counts. It is
+// rebased onto the global arrays once the sizes of earlier chunks are known.
+struct Fixup {
+    size_t corner;  // index into the face arrays
+    int kind;       // 0 = vertex, 1 = texCoord, 2 = normal
+};
+
+// Per-thread parse result of one newline-aligned slice of the file
+struct Chunk {
+    ObjData data;                         // materialNames holds chunk-local IDs
+    std::vector<uint32_t> faceMaterials;  // per face, NoMaterial before the chunk's first usemtl
+    std::vector<Fixup> fixups;
+    uint32_t currentMaterial = NoMaterial;  // material active at the end of the chunk
+};
+
+// Reads one "v", "v/vt", "v//vn" or "v/vt/vn" group. negativeMask gets bit k
+// set when component k was given as a relative index.
+inline bool parseCorner(const char*& p, const char* end, const ObjData& out, Corner& c, int& negativeMask) {
+    skipBlanks(p, end);
+    int index;
+    if (!parseInt(p, end, index)) return false;
+    c.v = resolveIndex(index, out.vertices.size());
+    c.vt = c.vn = -1;
+    negativeMask = index < 0 ? 1 : 0;
+
+    if (p < end && *p == '/') {
+        ++p;
+        if (parseInt(p, end, index)) {
+            c.vt = resolveIndex(index, out.texCoords.size());
+            if (index < 0) negativeMask |= 2;
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            if (parseInt(p, end, index)) {
+                c.vn = resolveIndex(index, out.normals.size());
+                if (index < 0) negativeMask |= 4;
+            }
+        }
+    }
+    return true;
+}
+
+// Parses [p, end) into out, recording each face's material in faceMaterials.
+// When chunk is non-null the range is one slice of a larger file: relative
+// indices are recorded for rebasing and faces seen before the first usemtl keep
+// NoMaterial so they can inherit the previous slice's material.
+void parseRange(const char* p, const char* end, ObjData& out, std::vector<uint32_t>& faceMaterials,
+                uint32_t& currentMaterial, Chunk* chunk) {
+    while (p < end) {
+        skipBlanks(p, end);
+        if (p >= end) break;
+
+        if (matchKeyword(p, end, "v", 1)) {
+            Vertex v;
+            v.x = parseFloat(p, end);
+            v.y = parseFloat(p, end);
+            v.z = parseFloat(p, end);
+            out.vertices.push_back(v);
+        }
+        else if (matchKeyword(p, end, "vt", 2)) {
+            TexCoord vt;
+            vt.u = parseFloat(p, end);
+            vt.v = parseFloat(p, end);
+            out.texCoords.push_back(vt);
+        }
+        else if (matchKeyword(p, end, "vn", 2)) {
+            Normal vn;
+            vn.x = parseFloat(p, end);
+            vn.y = parseFloat(p, end);
+            vn.z = parseFloat(p, end);
+            out.normals.push_back(vn);
+        }
+        else if (matchKeyword(p, end, "usemtl", 6)) {
+            currentMaterial = internMaterial(out.materialNames, parseToken(p, end));
+        }
+        else if (matchKeyword(p, end, "f", 1)) {
+            Corner corners[3];
+            int masks[3];
+            if (parseCorner(p, end, out, corners[0], masks[0]) && parseCorner(p, end, out, corners[1], masks[1])) {
+                // Faces before any usemtl belong to the unnamed material
+                if (!chunk && currentMaterial == NoMaterial) currentMaterial = internMaterial(out.materialNames, "");
+                while (parseCorner(p, end, out, corners[2], masks[2])) {
+                    for (int i = 0; i < 3; ++i) {
+                        if (chunk && masks[i]) {
+                            for (int kind = 0; kind < 3; ++kind) {
+                                if (masks[i] & (1 << kind)) chunk->fixups.push_back({ out.faceVertices.size(), kind });
+                            }
+                        }
+                        out.faceVertices.push_back(corners[i].v);
+                        out.faceTexCoords.push_back(corners[i].vt);
+                        out.faceNormals.push_back(corners[i].vn);
+                    }
+                    faceMaterials.push_back(currentMaterial);
+                    corners[1] = corners[2];  // fan triangulation
+                    masks[1] = masks[2];
+                }
+            }
+        }
+        skipLine(p, end);
+    }
+}
+
+// True when index names one of count elements; -1 (absent) is accepted where optional
+inline bool inRange(int index, size_t count, bool optional) {
+    return (optional && index == -1) || (index >= 0 && static_cast<size_t>(index) < count);
+}
+
+// Removes the faces with a corner indexing outside the final attribute arrays,
+// so later stages can index with what the parser returns. Runs once relative
+// indices are resolved against the whole file; returns how many were dropped.
+size_t dropInvalidFaces(ObjData& data, std::vector<uint32_t>& faceMaterials, size_t vertexCount,
+                        size_t texCoordCount, size_t normalCount) {
+    size_t kept = 0;
+    for (size_t f = 0; f < faceMaterials.size(); ++f) {
+        bool valid = true;
+        for (size_t c = f * 3; c < f * 3 + 3; ++c) {
+            valid = valid && inRange(data.faceVertices[c], vertexCount, false) &&
+                    inRange(data.faceTexCoords[c], texCoordCount, true) && inRange(data.faceNormals[c], normalCount, true);
+        }
+        if (!valid) continue;
+        for (size_t k = 0; k < 3; ++k) {
+            data.faceVertices[kept * 3 + k] = data.faceVertices[f * 3 + k];
+            data.faceTexCoords[kept * 3 + k] = data.faceTexCoords[f * 3 + k];
+            data.faceNormals[kept * 3 + k] = data.faceNormals[f * 3 + k];
+        }
+        faceMaterials[kept++] = faceMaterials[f];
+    }
+    const size_t dropped = faceMaterials.size() - kept;
+    faceMaterials.resize(kept);
+    data.faceVertices.resize(kept * 3);
+    data.faceTexCoords.resize(kept * 3);
+    data.faceNormals.resize(kept * 3);
+    return dropped;
+}
+
+void reportDroppedFaces(size_t dropped) {
+    if (dropped > 0) std::cerr << "OBJ: skipped " << dropped << " faces with out-of-range indices" << std::endl;
+}
+
+// Appends src to dst at a precomputed offset
+template <typename T>
+void moveInto(std::vector<T>& dst, size_t offset, std::vector<T>& src) {
+    std::move(src.begin(), src.end(), dst.begin() + offset);
+    std::vector<T>().swap(src);
+}
+
+// Counting sort of the faces by material ID, filling materialFaceStart
+void groupByMaterial(ObjData& out, const std::vector<uint32_t>& faceMaterials) {
+    const size_t materialCount = out.materialNames.size();
+    out.materialFaceStart.assign(materialCount + 1, 0);
+    for (uint32_t id : faceMaterials) ++out.materialFaceStart[id + 1];
+    for (size_t id = 0; id < materialCount; ++id) out.materialFaceStart[id + 1] += out.materialFaceStart[id];
+
+    // Exporters usually write each material as one run, already in first-use order
+    if (std::is_sorted(faceMaterials.begin(), faceMaterials.end())) return;
+
+    std::vector<size_t> next(out.materialFaceStart.begin(), out.materialFaceStart.end() - 1);
+    std::vector<int> vertices(out.faceVertices.size()), texCoords(out.faceTexCoords.size()), normals(out.faceNormals.size());
+    for (size_t f = 0; f < faceMaterials.size(); ++f) {
+        const size_t target = next[faceMaterials[f]]++;
+        for (int k = 0; k < 3; ++k) {
+            vertices[target * 3 + k] = out.faceVertices[f * 3 + k];
+            texCoords[target * 3 + k] = out.faceTexCoords[f * 3 + k];
+            normals[target * 3 + k] = out.faceNormals[f * 3 + k];
+        }
+    }
+    out.faceVertices.swap(vertices);
+    out.faceTexCoords.swap(texCoords);
+    out.faceNormals.swap(normals);
+}
+
+} // namespace
+
+void ObjParser::ParseOBJ(const char* data, size_t size, ObjData& out, unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, size / MinChunkBytes));
+
+    // Small files are not worth the thread start-up and merge cost
+    if (threadCount <= 1) {
+        std::vector<uint32_t> faceMaterials;
+        uint32_t currentMaterial = NoMaterial;
+        parseRange(data, data + size, out, faceMaterials, currentMaterial, nullptr);
+        reportDroppedFaces(dropInvalidFaces(out, faceMaterials, out.vertices.size(), out.texCoords.size(), out.normals.size()));
+        groupByMaterial(out, faceMaterials);
+        return;
+    }
+
+    // Split into newline-aligned slices of roughly equal size
+    std::vector<const char*> bounds{ data };
+    const char* end = data + size;
+    for (unsigned i = 1; i < threadCount; ++i) {
+        const char* p = std::max(bounds.back(), data + size / threadCount * i);
+        const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!nl) break;
+        bounds.push_back(static_cast<const char*>(nl) + 1);
+    }
+    bounds.push_back(end);
+
+    const size_t chunkCount = bounds.size() - 1;
+    std::vector<Chunk> chunks(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        workers.emplace_back([&, i] {
+            Chunk& c = chunks[i];
+            parseRange(bounds[i], bounds[i + 1], c.data, c.faceMaterials, c.currentMaterial, &c);
+        });
+    }
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+
+    // Prefix-sum the per-chunk attribute counts into global offsets, map
+    // chunk-local material IDs to global ones and carry the active material
+    // across chunks; face offsets wait until invalid faces are dropped
+    struct Offsets { size_t v, vt, vn, f; uint32_t material; };
+    std::vector<Offsets> offsets(chunkCount + 1);
+    std::vector<std::vector<uint32_t>> remaps(chunkCount);
+    offsets[0] = { 0, 0, 0, 0, NoMaterial };
+    for (size_t i = 0; i < chunkCount; ++i) {
+        Chunk& c = chunks[i];
+        // Interning in chunk order keeps the IDs in first-use order, as in a serial parse
+        if (offsets[i].material == NoMaterial && !c.faceMaterials.empty() && c.faceMaterials.front() == NoMaterial) {
+            offsets[i].material = internMaterial(out.materialNames, "");
+        }
+        for (const std::string& name : c.data.materialNames) remaps[i].push_back(internMaterial(out.materialNames, name));
+        offsets[i + 1] = { offsets[i].v + c.data.vertices.size(), offsets[i].vt + c.data.texCoords.size(),
+                           offsets[i].vn + c.data.normals.size(), 0,
+                           c.currentMaterial != NoMaterial ? remaps[i][c.currentMaterial] : offsets[i].material };
+    }
+
+    // Rebase the relative indices, then check every index against the whole file
+    std::vector<size_t> dropped(chunkCount, 0);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        workers.emplace_back([&, i] {
+            Chunk& c = chunks[i];
+            const Offsets& base = offsets[i];
+            for (const Fixup& fix : c.fixups) {
+                if (fix.kind == 0) c.data.faceVertices[fix.corner] += static_cast<int>(base.v);
+                else if (fix.kind == 1) c.data.faceTexCoords[fix.corner] += static_cast<int>(base.vt);
+                else c.data.faceNormals[fix.corner] += static_cast<int>(base.vn);
+            }
+            dropped[i] = dropInvalidFaces(c.data, c.faceMaterials, offsets[chunkCount].v, offsets[chunkCount].vt, offsets[chunkCount].vn);
+        });
+    }
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+    size_t droppedTotal = 0;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        offsets[i + 1].f = offsets[i].f + chunks[i].faceMaterials.size();
+        droppedTotal += dropped[i];
+    }
+    reportDroppedFaces(droppedTotal);
+    const size_t faceCount = offsets[chunkCount].f;
+    out.vertices.resize(offsets[chunkCount].v);
+    out.texCoords.resize(offsets[chunkCount].vt);
+    out.normals.resize(offsets[chunkCount].vn);
+    out.faceVertices.resize(faceCount * 3);
+    out.faceTexCoords.resize(faceCount * 3);
+    out.faceNormals.resize(faceCount * 3);
+    std::vector<uint32_t> faceMaterials(faceCount);
+
+    for (size_t i = 0; i < chunkCount; ++i) {
+        workers.emplace_back([&, i] {
+            Chunk& c = chunks[i];
+            const Offsets& base = offsets[i];
+            for (size_t f = 0; f < c.faceMaterials.size(); ++f) {
+                const uint32_t id = c.faceMaterials[f];
+                faceMaterials[base.f + f] = (id == NoMaterial) ? base.material : remaps[i][id];
+            }
+
+            moveInto(out.vertices, base.v, c.data.vertices);
+            moveInto(out.texCoords, base.vt, c.data.texCoords);
+            moveInto(out.normals, base.vn, c.data.normals);
+            moveInto(out.faceVertices, base.f * 3, c.data.faceVertices);
+            moveInto(out.faceTexCoords, base.f * 3, c.data.faceTexCoords);
+            moveInto(out.faceNormals, base.f * 3, c.data.faceNormals);
+        });
+    }
+    for (std::thread& t : workers) t.join();
+    groupByMaterial(out, faceMaterials);
+}
+
+void ObjParser::ParseMTL(const char* data, size_t size, std::map<std::string, Material>& materials) {
+    const char* p = data;
+    const char* end = data + size;
+    Material currentMaterial{};
+
+    while (p < end) {
+        skipBlanks(p, end);
+        if (p >= end) break;
+
+        if (matchKeyword(p, end, "newmtl", 6)) {
+            if (!currentMaterial.name.empty()) {
+                materials[currentMaterial.name] = currentMaterial;
+            }
+            currentMaterial = Material{};
+            currentMaterial.name = parseToken(p, end);
+        }
+        else if (matchKeyword(p, end, "Ka", 2)) {
+            parseColor(p, end, currentMaterial.Ka);
+        }
+        else if (matchKeyword(p, end, "Kd", 2)) {
+            parseColor(p, end, currentMaterial.Kd);
+        }
+        else if (matchKeyword(p, end, "Ks", 2)) {
+            parseColor(p, end, currentMaterial.Ks);
+        }
+        else if (matchKeyword(p, end, "Ns", 2)) {
+            currentMaterial.Ns = parseFloat(p, end);
+        }
+        else if (matchKeyword(p, end, "map_Kd", 6)) {
+            currentMaterial.diffuseTexture = parseToken(p, end);
+        }
+        skipLine(p, end);
+    }
+    if (!currentMaterial.name.empty()) {
+        materials[currentMaterial.name] = currentMaterial;
+    }
+}
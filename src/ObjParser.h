@@ -0,0 +1,59 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Structs to hold OBJ data
+
+struct Vertex { float x, y, z; };
+struct TexCoord { float u, v; };
+struct Normal { float x, y, z; };
+
+struct Material {
+    std::string name;
+    float Ka[3]; // Ambient
+    float Kd[3]; // Diffuse
+    float Ks[3]; // Specular
+    float Ns;    // Specular exponent; 0 when the MTL gives none
+    std::string diffuseTexture;
+
+    float shininess() const { return Ns > 0.0f ? Ns : 32.0f; }
+};
+
+struct ObjData {
+    std::vector<Vertex> vertices;
+    std::vector<TexCoord> texCoords;
+    std::vector<Normal> normals;
+    // Triangles as structure-of-arrays, three entries per face, grouped by
+    // material: faces [materialFaceStart[id], materialFaceStart[id + 1]) use materialNames[id]
+    std::vector<int> faceVertices;
+    std::vector<int> faceTexCoords;   // -1 when the corner has no texture coordinate
+    std::vector<int> faceNormals;     // -1 when the corner has no normal
+    std::vector<std::string> materialNames;  // usemtl names interned to dense IDs in first-use order
+    std::vector<size_t> materialFaceStart;   // materialNames.size() + 1 entries
+
+    size_t faceCount() const { return faceVertices.size() / 3; }
+};
+
+// Hand-rolled OBJ scanner. Walks a contiguous byte buffer in place and reads
+// numbers with std::from_chars, so no line is ever copied into a std::string.
+class ObjParser {
+public:
+    // Parses the OBJ text in [data, data + size) into an empty out.
+    // Polygons with more than three corners are fan-triangulated.
+    // Faces with an index outside the file's v/vt/vn lists are skipped.
+    // Inputs larger than MinChunkBytes are split into newline-aligned chunks
+    // parsed on up to threadCount threads (0 = one per hardware thread).
+    static void ParseOBJ(const char* data, size_t size, ObjData& out, unsigned threadCount = 0);
+
+    static constexpr size_t MinChunkBytes = 4 << 20;
+
+    // Adds every material of the MTL text in [data, data + size) to materials, keyed by name.
+    static void ParseMTL(const char* data, size_t size, std::map<std::string, Material>& materials);
+};
+
+#endif
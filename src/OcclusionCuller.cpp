@@ -0,0 +1,207 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+OcclusionCuller::OcclusionCuller(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    tiles.resize(TilesX * TilesY);
+    rowTriangles.resize(TilesY);
+    startWorkers(threadCount - 1);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    stopWorkers();
+}
+
+void OcclusionCuller::startWorkers(unsigned count) {
+    // A joinable std::thread terminates the program when destroyed, so the
+    // ones already running are joined before a failed start propagates
+    try {
+        for (unsigned part = 1; part <= count; ++part) workers.emplace_back(&OcclusionCuller::workerLoop, this, part);
+    } catch (...) {
+        stopWorkers();
+        throw;
+    }
+}
+
+void OcclusionCuller::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& frameViewProjection, float frameNearPlane) {
+    viewProjection = frameViewProjection;
+    nearPlane = frameNearPlane;
+    std::fill(tiles.begin(), tiles.end(), Tile{ 0, std::numeric_limits<float>::infinity(), 0.0f });
+    triangles.clear();
+    stats = { 0, 0, 0, 0.0 };
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const glm::mat4& model) {
+    const glm::mat4 toClip = viewProjection * model;
+    clipPositions.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) clipPositions[v] = toClip * glm::vec4(positions[v], 1.0f);
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const glm::vec4* clip[3] = { &clipPositions[indices[i]], &clipPositions[indices[i + 1]], &clipPositions[indices[i + 2]] };
+        // Clipping is not worth it for occluders; dropping the triangle is conservative
+        if (clip[0]->w <= nearPlane || clip[1]->w <= nearPlane || clip[2]->w <= nearPlane) continue;
+
+        ScreenTriangle triangle;
+        glm::vec2 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+        triangle.maxDepth = 0.0f;
+        for (int c = 0; c < 3; ++c) {
+            const glm::vec2 ndc = glm::vec2(*clip[c]) / clip[c]->w;
+            triangle.corners[c] = (ndc * 0.5f + 0.5f) * glm::vec2(Width, Height);
+            lo = glm::min(lo, triangle.corners[c]);
+            hi = glm::max(hi, triangle.corners[c]);
+            triangle.maxDepth = std::max(triangle.maxDepth, clip[c]->w);
+        }
+        if (hi.x < 0.0f || hi.y < 0.0f || lo.x >= Width || lo.y >= Height) continue;
+        triangle.firstRow = std::max(0, static_cast<int>(lo.y) / TileSize);
+        triangle.lastRow = std::min(TilesY - 1, static_cast<int>(hi.y) / TileSize);
+        triangles.push_back(triangle);
+    }
+    stats.occluderTriangles += indexCount / 3;
+}
+
+void OcclusionCuller::rasterize() {
+    const auto start = std::chrono::steady_clock::now();
+    for (std::vector<uint32_t>& row : rowTriangles) row.clear();
+    for (uint32_t i = 0; i < triangles.size(); ++i) {
+        for (int row = triangles[i].firstRow; row <= triangles[i].lastRow; ++row) rowTriangles[row].push_back(i);
+    }
+
+    // Rows are disjoint in the buffer, so the parts need no locking among themselves
+    const unsigned partCount = static_cast<unsigned>(workers.size()) + 1;
+    if (partCount > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = partCount - 1;
+            ++generation;
+        }
+        wake.notify_all();
+    }
+    rasterizeRows(0, partCount);
+    if (partCount > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+    }
+    stats.rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::workerLoop(unsigned part) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        rasterizeRows(part, static_cast<unsigned>(workers.size()) + 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeRows(unsigned part, unsigned partCount) {
+    for (int row = static_cast<int>(part); row < TilesY; row += static_cast<int>(partCount)) {
+        for (uint32_t i : rowTriangles[row]) drawTriangle(triangles[i], row);
+    }
+}
+
+void OcclusionCuller::drawTriangle(const ScreenTriangle& triangle, int tileRow) {
+    // Edge functions a * x + b * y + c, oriented so the inside is positive
+    const glm::vec2* v = triangle.corners;
+    const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    if (area == 0.0f) return;
+    const float sign = area > 0.0f ? 1.0f : -1.0f;
+    float a[3], b[3], c[3];
+    for (int e = 0; e < 3; ++e) {
+        const glm::vec2& p = v[e];
+        const glm::vec2& q = v[(e + 1) % 3];
+        a[e] = sign * (p.y - q.y);
+        b[e] = sign * (q.x - p.x);
+        c[e] = -(a[e] * p.x + b[e] * p.y);
+    }
+
+    // Pixel bounds of the triangle; only those pixels of a tile are evaluated
+    const int minX = std::max(0, static_cast<int>(std::floor(std::min({ v[0].x, v[1].x, v[2].x }))));
+    const int maxX = std::min(Width - 1, static_cast<int>(std::floor(std::max({ v[0].x, v[1].x, v[2].x }))));
+    const int minY = std::max(tileRow * TileSize, static_cast<int>(std::floor(std::min({ v[0].y, v[1].y, v[2].y }))));
+    const int maxY = std::min(tileRow * TileSize + TileSize - 1, static_cast<int>(std::floor(std::max({ v[0].y, v[1].y, v[2].y }))));
+    if (minX > maxX || minY > maxY) return;
+    for (int column = minX / TileSize; column <= maxX / TileSize; ++column) {
+        // Coverage of the tile's pixel centres, bit y * 8 + x
+        const int firstX = std::max(minX - column * TileSize, 0), lastX = std::min(maxX - column * TileSize, TileSize - 1);
+        uint64_t mask = 0;
+        for (int y = minY - tileRow * TileSize; y <= maxY - tileRow * TileSize; ++y) {
+            const float py = tileRow * TileSize + y + 0.5f;
+            for (int x = firstX; x <= lastX; ++x) {
+                const float px = column * TileSize + x + 0.5f;
+                const bool inside = a[0] * px + b[0] * py + c[0] >= 0.0f && a[1] * px + b[1] * py + c[1] >= 0.0f &&
+                                    a[2] * px + b[2] * py + c[2] >= 0.0f;
+                mask |= static_cast<uint64_t>(inside) << (y * TileSize + x);
+            }
+        }
+        if (mask == 0) continue;
+
+        // Merge into the tile's two layers. A triangle behind zMax0 adds
+        // nothing; one much nearer than the working layer replaces it.
+        Tile& tile = tiles[tileRow * TilesX + column];
+        const float depth = triangle.maxDepth;
+        if (depth >= tile.zMax0) continue;
+        if (tile.zMax1 - depth > tile.zMax0 - tile.zMax1) {
+            tile.zMax1 = 0.0f;
+            tile.mask = 0;
+        }
+        tile.zMax1 = std::max(tile.zMax1, depth);
+        tile.mask |= mask;
+        if (tile.mask == ~uint64_t(0)) {
+            // Fully covered: the working layer becomes the tile's bound
+            tile.zMax0 = tile.zMax1;
+            tile.zMax1 = 0.0f;
+            tile.mask = 0;
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model) {
+    ++stats.tested;
+    const glm::mat4 toClip = viewProjection * model;
+    glm::vec2 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+    float nearest = std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 p((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+        const glm::vec4 clip = toClip * glm::vec4(p, 1.0f);
+        if (clip.w <= nearPlane) return true;  // reaches the camera
+        const glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(Width, Height);
+        lo = glm::min(lo, screen);
+        hi = glm::max(hi, screen);
+        nearest = std::min(nearest, clip.w);
+    }
+    if (hi.x < 0.0f || hi.y < 0.0f || lo.x >= Width || lo.y >= Height) return true;  // off screen is the frustum's call
+
+    // Visible as soon as one covered tile may hold something farther than the box's nearest point
+    const int firstColumn = std::max(0, static_cast<int>(std::floor(lo.x)) / TileSize);
+    const int lastColumn = std::min(TilesX - 1, static_cast<int>(std::floor(hi.x)) / TileSize);
+    const int firstRow = std::max(0, static_cast<int>(std::floor(lo.y)) / TileSize);
+    const int lastRow = std::min(TilesY - 1, static_cast<int>(std::floor(hi.y)) / TileSize);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            if (nearest <= tiles[row * TilesX + column].zMax0) return true;
+        }
+    }
+    ++stats.culled;
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Counts for the current frame, reset by beginFrame
+struct OcclusionStats {
+    size_t occluderTriangles;  // submitted through addOccluder
+    size_t tested;             // isVisible calls
+    size_t culled;             // of those, found hidden
+    double rasterMs;           // wall time of rasterize
+};
+
+// Masked software occlusion culling. Occluder triangles are rasterized on the
+// CPU into a low-resolution depth buffer of 8x8-pixel tiles; each tile keeps a
+// coverage mask plus two farthest depths instead of per-pixel values, so a
+// tile is resolved to a single conservative depth once occluders cover it
+// completely. Bounds are then tested against those tile depths.
+// Depth is view-space distance (clip w). Occluders must be closed or
+// conservative: an occluder pixel is treated as fully covered when its
+// centre is, so thin slivers can hide objects that peek through them.
+class OcclusionCuller {
+public:
+    static constexpr int Width = 320;
+    static constexpr int Height = 192;
+    static constexpr int TileSize = 8;  // 64 pixels, one coverage bit each
+    static constexpr int TilesX = Width / TileSize;
+    static constexpr int TilesY = Height / TileSize;
+    // How far, in buffer pixels, a simplified occluder may stray from the real
+    // surface; pixel-centre coverage already errs by up to half a pixel
+    static constexpr float MaxOccluderPixelError = 0.5f;
+
+    // Rows of tiles are split between threadCount threads, the caller's
+    // included (0 = one per hardware thread, at most four)
+    explicit OcclusionCuller(unsigned threadCount = 0);
+    ~OcclusionCuller();
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // Clears the buffer and the stats; nearPlane is the camera's near distance
+    void beginFrame(const glm::mat4& viewProjection, float nearPlane);
+    // Queues a model-space triangle list. Triangles crossing the near plane are dropped.
+    void addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const glm::mat4& model);
+    // Draws everything queued since beginFrame
+    void rasterize();
+    // False when the box, transformed by model, lies behind the rasterized
+    // occluders everywhere it covers on screen
+    bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model);
+
+    const OcclusionStats& getStats() const { return stats; }
+
+private:
+    struct Tile {
+        uint64_t mask;  // pixels whose depth is bounded by zMax1
+        float zMax0;    // bound for every pixel of the tile
+        float zMax1;    // bound for the masked pixels; 0 when the mask is empty
+    };
+    struct ScreenTriangle {
+        glm::vec2 corners[3];  // pixels
+        float maxDepth;
+        int firstRow, lastRow;  // tile rows touched
+    };
+
+    std::vector<Tile> tiles;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<uint32_t>> rowTriangles;  // per tile row, rebuilt by rasterize
+    std::vector<glm::vec4> clipPositions;             // addOccluder scratch
+    glm::mat4 viewProjection{ 1.0f };
+    float nearPlane = 0.1f;
+    OcclusionStats stats{ 0, 0, 0, 0.0 };
+
+    // Worker i rasterizes the tile rows r with r % (workers + 1) == i + 1
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    uint64_t generation = 0;
+    unsigned pending = 0;
+    bool stopping = false;
+
+    void startWorkers(unsigned count);
+    void stopWorkers();
+    void workerLoop(unsigned part);
+    void rasterizeRows(unsigned part, unsigned partCount);
+    void drawTriangle(const ScreenTriangle& triangle, int tileRow);
+};
+
+#endif
\ No newline at end of file
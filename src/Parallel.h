@@ -0,0 +1,30 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into contiguous batches of at least minBatch items and
+// calls fn(begin, end) for each, one batch per hardware thread. The calling
+// thread runs the first batch; small counts run inline without spawning.
+template <typename Fn>
+void ParallelFor(size_t count, size_t minBatch, Fn&& fn) {
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t batches = std::min(hardware, std::max<size_t>(count / std::max<size_t>(minBatch, 1), 1));
+    if (batches <= 1) {
+        if (count > 0) fn(size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(batches - 1);
+    for (size_t b = 1; b < batches; ++b) {
+        workers.emplace_back([&fn, b, batches, count] { fn(count * b / batches, count * (b + 1) / batches); });
+    }
+    fn(size_t(0), count / batches);
+    for (std::thread& t : workers) t.join();
+}
+
+#endif
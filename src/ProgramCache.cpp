@@ -0,0 +1,110 @@
+#include "ProgramCache.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char Magic[8] = { 'G', 'R', 'F', 'K', 'P', 'R', 'O', 'G' };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;   // binaryFormat from glGetProgramBinary
+    uint64_t key;
+    uint64_t length;
+};
+
+std::string pathFor(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return std::string(ProgramCache::Directory) + "/" + name;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // namespace
+
+bool ProgramCache::Supported() {
+    static int supported = -1;
+    if (supported < 0) {
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0 ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+uint64_t ProgramCache::Key(const std::string& vertexCode, const std::string& fragmentCode) {
+    const std::string renderer = glString(GL_RENDERER), version = glString(GL_VERSION);
+    uint64_t key = MeshCache::Hash(vertexCode.data(), vertexCode.size(), Version);
+    key = MeshCache::Hash(fragmentCode.data(), fragmentCode.size(), key);
+    key = MeshCache::Hash(renderer.data(), renderer.size(), key);
+    return MeshCache::Hash(version.data(), version.size(), key);
+}
+
+void ProgramCache::MarkRetrievable(GLuint program) {
+    if (Supported()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramCache::Load(GLuint program, uint64_t key) {
+    if (!Supported()) return false;
+    std::ifstream file(pathFor(key), std::ios::binary);
+    if (!file) return false;
+
+    Header header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version || header.key != key || header.length == 0 || header.length > (1u << 30)) {
+        return false;
+    }
+    std::vector<char> binary(static_cast<size_t>(header.length));
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!file) return false;
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+bool ProgramCache::Store(GLuint program, uint64_t key) {
+    if (!Supported()) return false;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(Directory, error);
+
+    // Write to a temporary name and rename, so a crash never leaves a torn entry
+    const std::string path = pathFor(key), tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.format = format;
+        header.key = key;
+        header.length = static_cast<uint64_t>(length);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            std::cerr << "Failed to write program cache: " << path << std::endl;
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,34 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary). Entries are
+// keyed by a hash of the shader sources, GL_RENDERER and GL_VERSION, so a
+// driver or GPU change misses instead of loading a binary the driver would
+// reject. Drivers may still reject a binary; Load then reports a miss and the
+// caller compiles from source.
+class ProgramCache {
+public:
+    // Bump whenever the file layout changes
+    static constexpr uint32_t Version = 1;
+    // Relative to the working directory, like the assets
+    static constexpr const char* Directory = "shadercache";
+
+    // False without GL 4.1 / ARB_get_program_binary or when the driver offers no binary formats
+    static bool Supported();
+
+    static uint64_t Key(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Call before linking a program that will be stored
+    static void MarkRetrievable(GLuint program);
+
+    // Loads the cached binary into program; true if it linked
+    static bool Load(GLuint program, uint64_t key);
+    // Stores a successfully linked program
+    static bool Store(GLuint program, uint64_t key);
+};
+
+#endif
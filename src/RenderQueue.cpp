@@ -0,0 +1,138 @@
+#include "RenderQueue.h"
+#include "UniformBuffers.h"
+#include "Shader.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Key layout, most significant first: pass 4 bits, program 12, texture 16,
+// VAO (format and page) 8, depth 24. Names are truncated to their field;
+// that can only make the order less than ideal, since every bind is still
+// compared against the full state on submission.
+uint64_t sortKey(const DrawState& state, float depth, float farPlane) {
+    const float normalized = std::min(std::max(depth / farPlane, 0.0f), 1.0f);
+    const uint64_t quantizedDepth = static_cast<uint64_t>(normalized * 16777215.0f);
+    const uint64_t vertexArray = (static_cast<uint64_t>(state.format) << 7) | (state.page & 0x7Fu);
+    return (static_cast<uint64_t>(state.pass) & 0xFu) << 60 |
+           (static_cast<uint64_t>(state.program) & 0xFFFu) << 48 |
+           (static_cast<uint64_t>(state.texture) & 0xFFFFu) << 32 |
+           (vertexArray & 0xFFu) << 24 |
+           quantizedDepth;
+}
+
+} // namespace
+
+void RenderQueue::add(const DrawState& state, const DrawCommand* drawCommands, size_t count, float depth) {
+    if (count == 0) return;
+    packets.push_back({ state, depth, static_cast<uint32_t>(commands.size()), static_cast<uint32_t>(count) });
+    commands.insert(commands.end(), drawCommands, drawCommands + count);
+}
+
+void RenderQueue::sort() {
+    // LSD radix sort on 8-bit digits; a digit every key shares is skipped,
+    // which with few programs and textures is most of them
+    const size_t count = keys.size();
+    keyScratch.resize(count);
+    orderScratch.resize(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (uint64_t key : keys) ++histogram[(key >> shift) & 0xFF];
+        if (histogram[(keys[0] >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            const size_t n = bucket;
+            bucket = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const size_t slot = histogram[(keys[i] >> shift) & 0xFF]++;
+            keyScratch[slot] = keys[i];
+            orderScratch[slot] = order[i];
+        }
+        keys.swap(keyScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void RenderQueue::flush(float farPlane) {
+    stats = { packets.size(), commands.size(), 0, 0 };
+    if (packets.empty()) {
+        commands.clear();
+        return;
+    }
+
+    keys.resize(packets.size());
+    order.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        keys[i] = sortKey(packets[i].state, packets[i].depth, farPlane);
+        order[i] = static_cast<uint32_t>(i);
+    }
+    sort();
+    UniformBuffers::Upload();  // the object blocks the packets point at, in one write
+
+    // Nothing is assumed about the state left by earlier frames or other code
+    RenderPass pass = RenderPass::Opaque;
+    bool passSet = false;
+    GLuint program = 0, texture = 0, instanceTexture = 0, materialBuffer = 0;
+    bool programSet = false;
+    size_t objectOffset = std::numeric_limits<size_t>::max(), materialOffset = 0;
+    uint32_t vertexArray = std::numeric_limits<uint32_t>::max();
+    size_t requested = 0;
+
+    for (uint32_t index : order) {
+        const Packet& packet = packets[index];
+        const DrawState& state = packet.state;
+        requested += 4 + (state.texture != 0) + (state.instanceTexture != 0) + (state.materialBuffer != 0);
+
+        if (!passSet || state.pass != pass) {
+            glPolygonMode(GL_FRONT_AND_BACK, state.pass == RenderPass::Wireframe ? GL_LINE : GL_FILL);
+            pass = state.pass;
+            passSet = true;
+            ++stats.stateChanges;
+        }
+        if (!programSet || state.program != program) {
+            glUseProgram(state.program);
+            program = state.program;
+            programSet = true;
+            ++stats.stateChanges;
+        }
+        if (state.texture != 0 && state.texture != texture) {
+            glActiveTexture(GL_TEXTURE0 + DiffuseTextureUnit);
+            glBindTexture(GL_TEXTURE_2D, state.texture);
+            texture = state.texture;
+            ++stats.stateChanges;
+        }
+        if (state.instanceTexture != 0 && state.instanceTexture != instanceTexture) {
+            glActiveTexture(GL_TEXTURE0 + InstanceTextureUnit);
+            glBindTexture(GL_TEXTURE_BUFFER, state.instanceTexture);
+            glActiveTexture(GL_TEXTURE0 + DiffuseTextureUnit);
+            instanceTexture = state.instanceTexture;
+            ++stats.stateChanges;
+        }
+        if (state.materialBuffer != 0 && (state.materialBuffer != materialBuffer || state.materialOffset != materialOffset)) {
+            glBindBufferRange(GL_UNIFORM_BUFFER, UniformBuffers::MaterialBinding, state.materialBuffer, state.materialOffset, sizeof(MaterialUniforms));
+            materialBuffer = state.materialBuffer;
+            materialOffset = state.materialOffset;
+            ++stats.stateChanges;
+        }
+        if (state.objectOffset != objectOffset) {
+            UniformBuffers::BindObject(state.objectOffset);
+            objectOffset = state.objectOffset;
+            ++stats.stateChanges;
+        }
+        // GeometryArena binds the page's VAO itself when it changes
+        const uint32_t packetVertexArray = (static_cast<uint32_t>(state.format) << 24) | state.page;
+        if (packetVertexArray != vertexArray) {
+            vertexArray = packetVertexArray;
+            ++stats.stateChanges;
+        }
+        GeometryArena::MultiDraw(state.format, state.page, state.indexType, &commands[packet.firstCommand], packet.commandCount);
+    }
+    if (pass != RenderPass::Opaque) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    stats.stateChangesSaved = requested - stats.stateChanges;
+
+    packets.clear();
+    commands.clear();
+}
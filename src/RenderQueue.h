@@ -0,0 +1,68 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GeometryArena.h"
+#include "VertexLayout.h"
+
+// Passes run in this order; the pass is the most significant part of a sort key
+enum class RenderPass : uint32_t {
+    Opaque = 0,
+    Wireframe = 1   // drawn with glPolygonMode(GL_LINE)
+};
+
+// Everything a packet binds before its multi-draw
+struct DrawState {
+    RenderPass pass = RenderPass::Opaque;
+    GLuint program = 0;
+    GLuint texture = 0;           // on unit 0; 0 leaves the current texture bound
+    GLuint instanceTexture = 0;   // InstanceBuffer texture on unit 1, for instanced variants
+    GLuint materialBuffer = 0;    // uniform buffer for the Materials block, 0 for none
+    size_t materialOffset = 0;    // byte offset of the block in materialBuffer
+    size_t objectOffset = 0;      // UniformBuffers::WriteObject offset
+    VertexFormat format = VertexFormat::Float32;
+    uint32_t page = 0;            // GeometryArena page, i.e. the VAO
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+// State changes issued by the last flush, against binding every packet's full state
+struct RenderQueueStats {
+    size_t packets;
+    size_t draws;         // DrawCommands submitted
+    size_t stateChanges;  // program, texture, instance, material, object, VAO and polygon mode binds issued
+    size_t stateChangesSaved;
+};
+
+// Deferred submission: packets are recorded during the frame, radix-sorted on
+// a 64-bit key (pass, program, texture, VAO, then depth front to back) and
+// issued in one go with binds that repeat the current state dropped.
+// flush() needs the GL context thread.
+class RenderQueue {
+public:
+    // Copies the commands; depth is the view distance, used as the last sort criterion
+    void add(const DrawState& state, const DrawCommand* commands, size_t count, float depth);
+    // Sorts, submits and empties the queue
+    void flush(float farPlane);
+
+    const RenderQueueStats& getStats() const { return stats; }
+
+private:
+    struct Packet {
+        DrawState state;
+        float depth;
+        uint32_t firstCommand, commandCount;
+    };
+    std::vector<Packet> packets;
+    std::vector<DrawCommand> commands;
+    // Sort keys and packet indices, plus the radix sort's ping-pong buffers
+    std::vector<uint64_t> keys, keyScratch;
+    std::vector<uint32_t> order, orderScratch;
+    RenderQueueStats stats{ 0, 0, 0, 0 };
+
+    void sort();
+};
+
+#endif
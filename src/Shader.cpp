@@ -2,10 +2,36 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include "Model.h"
+#include "UniformBuffers.h"
+#include "ProgramCache.h"
 #include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+namespace {
+
+// Inserts the preamble after the #version line, which has to stay first
+std::string injectDefines(const std::string& code, const std::string& preamble) {
+    size_t at = 0;
+    if (code.compare(0, 8, "#version") == 0) {
+        at = code.find('\n');
+        at = (at == std::string::npos) ? code.size() : at + 1;
+    }
+    std::string result;
+    result.reserve(code.size() + preamble.size() + 1);
+    result.append(code, 0, at);
+    if (at > 0 && code[at - 1] != '\n') result += '\n';
+    result += preamble;
+    result.append(code, at, std::string::npos);
+    return result;
+}
+
+} // namespace
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, Compile mode, const std::string& defines) {
+    label = vertexPath;
+    compileStart = std::chrono::steady_clock::now();
     std::string vertexCode, fragmentCode;
     std::ifstream vShaderFile, fShaderFile;
     
@@ -24,36 +50,158 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         std::cerr << "ERROR::SHADER::FILE_NOT_READ" << std::endl;
     }
     
+    const std::string preamble = "#define MAX_LIGHTS " + std::to_string(UniformBuffers::MaxLights) + "\n" + defines;
+    vertexCode = injectDefines(vertexCode, preamble);
+    fragmentCode = injectDefines(fragmentCode, preamble);
+    // Name the variant in log messages
+    for (size_t pos = defines.find("#define "); pos != std::string::npos; pos = defines.find("#define ", pos)) {
+        pos += 8;
+        label += (label.find('[') == std::string::npos) ? " [" : " ";
+        label += defines.substr(pos, defines.find('\n', pos) - pos);
+    }
+    if (label.find('[') != std::string::npos) label += "]";
+
+    // A cached binary of the same sources for this driver skips compiling and linking
+    cacheable = ProgramCache::Supported();
+    cacheKey = cacheable ? ProgramCache::Key(vertexCode, fragmentCode) : 0;
+    ID = glCreateProgram();
+    if (cacheable && ProgramCache::Load(ID, cacheKey)) {
+        finishCompile(true);
+        return;
+    }
+    // Missing or rejected: the failed glProgramBinary leaves the program unusable, start over
+    if (cacheable) {
+        glDeleteProgram(ID);
+        ID = glCreateProgram();
+    }
+
+    // Issue the compiles and the link without reading any status back, so a
+    // driver with parallel compilation works on them while we load other data
+    parallelCompile = enableParallelCompile();
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
-    unsigned int vertex, fragment;
     
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
+    pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pendingVertex, 1, &vShaderCode, NULL);
+    glCompileShader(pendingVertex);
     
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
+    pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pendingFragment, 1, &fShaderCode, NULL);
+    glCompileShader(pendingFragment);
     
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    glAttachShader(ID, pendingVertex);
+    glAttachShader(ID, pendingFragment);
+    ProgramCache::MarkRetrievable(ID);
     glLinkProgram(ID);
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+
+    if (mode == Compile::Blocking) wait();
+}
+
+bool Shader::enableParallelCompile() {
+    static int supported = -1;
+    if (supported < 0) {
+        supported = (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) ? 1 : 0;
+        // Let the driver pick its own number of compiler threads
+        if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+    }
+    return supported == 1;
+}
+
+bool Shader::poll() {
+    if (ready) return true;
+    // Without parallel compile support there is nothing to poll: reading the
+    // link status below waits for the driver
+    if (parallelCompile) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+        if (complete == GL_FALSE) return false;
+    }
+    finishCompile(false);
+    return true;
+}
+
+void Shader::wait() {
+    while (!poll()) std::this_thread::yield();
+}
+
+void Shader::finishCompile(bool fromCache) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &status);
+    linked = status == GL_TRUE;
+    if (!linked) {
+        for (GLuint shader : { pendingVertex, pendingFragment }) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+            if (compiled == GL_TRUE) continue;
+            char log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "ERROR::SHADER::COMPILATION_FAILED " << label << "\n" << log << std::endl;
+        }
+        char log[1024] = {};
+        glGetProgramInfoLog(ID, sizeof(log), nullptr, log);
+        std::cerr << "ERROR::PROGRAM::LINKING_FAILED " << label << "\n" << log << std::endl;
+    }
+    if (pendingVertex != 0) glDeleteShader(pendingVertex);
+    if (pendingFragment != 0) glDeleteShader(pendingFragment);
+    pendingVertex = pendingFragment = 0;
+
+    if (linked) {
+        if (cacheable && !fromCache) ProgramCache::Store(ID, cacheKey);
+        // Block bindings are program state that linking (or loading a binary) resets
+        UniformBuffers::BindBlocks(ID);  // Frame and Object blocks come from the shared uniform buffer
+        reflectUniforms();
+        // Samplers are program state too; give them their fixed units once
+        glUseProgram(ID);
+        setInt("diffuseMap", DiffuseTextureUnit);
+        setInt("instanceData", InstanceTextureUnit);
+        glUseProgram(0);
+    }
+    compileEnd = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(compileEnd - compileStart).count();
+    if (fromCache) {
+        std::cout << label << ": program binary cache hit, loaded in " << ms << " ms" << std::endl;
+    } else {
+        std::cout << label << ": program binary cache " << (cacheable ? "miss" : "unsupported") << ", "
+                  << (parallelCompile ? "compiled in parallel" : "compiled") << " in " << ms << " ms" << std::endl;
+    }
+    ready = true;
+}
+
+void Shader::reflectUniforms() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+    uniforms.clear();
+    uniforms.reserve(count);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data());
+        name[length] = '\0';
+        const GLint location = glGetUniformLocation(ID, name.data());
+        if (location < 0) continue;  // member of a uniform block
+        // Arrays are reported as "name[0]" but set by their plain name
+        if (length > 3 && strcmp(&name[length - 3], "[0]") == 0) name[length - 3] = '\0';
+        uniforms.push_back({ HashUniformName(name.data()), location });
+    }
+    std::sort(uniforms.begin(), uniforms.end(), [](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < uniforms.size(); ++i) {
+        if (uniforms[i].hash == uniforms[i - 1].hash) std::cerr << "Uniform name hash collision in program " << ID << std::endl;
+    }
+}
+
+GLint Shader::location(UniformName name) const {
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name.hash,
+                               [](const UniformEntry& entry, uint32_t hash) { return entry.hash < hash; });
+    return (it != uniforms.end() && it->hash == name.hash) ? it->location : -1;
 }
 
 void Shader::use() { glUseProgram(ID); }
-void Shader::setBool(const std::string &name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
-void Shader::setInt(const std::string &name, int value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setFloat(const std::string &name, float value) const { glUniform1f(glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const { glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z); }
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const { glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
-
-void Shader::setMaterial(const std::string& name, const Material& material) const {
-    setVec3(name + ".ambient", glm::vec3(material.Ka[0], material.Ka[1], material.Ka[2]));
-    setVec3(name + ".diffuse", glm::vec3(material.Kd[0], material.Kd[1], material.Kd[2]));
-    setVec3(name + ".specular", glm::vec3(material.Ks[0], material.Ks[1], material.Ks[2]));
-    setFloat(name + ".shininess", 32.0f);
-}
\ No newline at end of file
+void Shader::setBool(UniformName name, bool value) const { glUniform1i(location(name), static_cast<int>(value)); }
+void Shader::setInt(UniformName name, int value) const { glUniform1i(location(name), value); }
+void Shader::setFloat(UniformName name, float value) const { glUniform1f(location(name), value); }
+void Shader::setVec3(UniformName name, const glm::vec3 &value) const { glUniform3f(location(name), value.x, value.y, value.z); }
+void Shader::setMat4(UniformName name, const glm::mat4 &mat) const { glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]); }
\ No newline at end of file
@@ -6,26 +6,91 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-struct Material;
+
+// FNV-1a hash of a uniform name
+constexpr uint32_t HashUniformName(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (; *name; ++name) hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+    return hash;
+}
+
+// A uniform name reduced to its hash; built from a literal it is hashed at compile time
+struct UniformName {
+    uint32_t hash;
+    constexpr UniformName(const char* name) : hash(HashUniformName(name)) {}
+    UniformName(const std::string& name) : hash(HashUniformName(name.c_str())) {}
+};
+
+// Texture units the samplers are assigned to when a program links
+enum TextureUnit : GLint {
+    DiffuseTextureUnit = 0,   // diffuseMap
+    InstanceTextureUnit = 1   // instanceData
+};
 
 class Shader {
 public:
     // The program ID
     GLuint ID;
 
-    // Constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
+    enum class Compile {
+        Blocking,  // the constructor returns with the program linked
+        Async      // the constructor only issues the compile and link; see poll()
+    };
+
+    // Constructor reads and builds the shader. defines ("#define NAME value"
+    // lines) are inserted into both stages after #version, together with the
+    // MAX_LIGHTS every shader's Frame block needs.
+    Shader(const char* vertexPath, const char* fragmentPath, Compile mode = Compile::Blocking,
+           const std::string& defines = std::string());
+
+    // True once the program has finished compiling and linking, successfully
+    // or not. With KHR_parallel_shader_compile this never blocks; without it
+    // the first call waits for the driver.
+    bool poll();
+    void wait();
+    bool isLinked() const { return linked; }
+    // From reading the sources to the poll that saw the link finish
+    std::chrono::steady_clock::time_point getCompileStart() const { return compileStart; }
+    std::chrono::steady_clock::time_point getCompileEnd() const { return compileEnd; }
 
     // Use the program
     void use();
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec3(const std::string &name, const glm::vec3 &value) const;
-    void setMat4(const std::string &name, const glm::mat4 &mat) const;
-    void setMaterial(const std::string& name, const Material& material) const;
+
+    // Location from the table reflected at link time; no driver call
+    GLint location(UniformName name) const;
+
+    // Default-block uniforms, which are only program state set once (samplers,
+    // constants); per-frame and per-object data lives in UniformBuffers
+    void setBool(UniformName name, bool value) const;
+    void setInt(UniformName name, int value) const;
+    void setFloat(UniformName name, float value) const;
+    void setVec3(UniformName name, const glm::vec3 &value) const;
+    void setMat4(UniformName name, const glm::mat4 &mat) const;
+
+private:
+    struct UniformEntry {
+        uint32_t hash;
+        GLint location;
+    };
+    std::vector<UniformEntry> uniforms;  // default-block uniforms, sorted by hash
+
+    // Compile state until poll() sees the link finish
+    std::string label;
+    GLuint pendingVertex = 0, pendingFragment = 0;
+    bool cacheable = false;
+    uint64_t cacheKey = 0;
+    bool parallelCompile = false;
+    bool ready = false, linked = false;
+    std::chrono::steady_clock::time_point compileStart, compileEnd;
+
+    static bool enableParallelCompile();
+    void finishCompile(bool fromCache);
+    void reflectUniforms();
 };
 
 #endif
\ No newline at end of file
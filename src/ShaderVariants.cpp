@@ -0,0 +1,28 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+std::string ShaderVariants::Defines(uint32_t key) {
+    const uint32_t features = Features(key);
+    std::string defines;
+    if (features & ShaderTextured) defines += "#define TEXTURED\n";
+    if (features & ShaderSpecular) defines += "#define SPECULAR\n";
+    if (features & ShaderPackedVertices) defines += "#define PACKED_VERTICES\n";
+    if (features & ShaderInstanced) defines += "#define INSTANCED\n";
+    defines += "#define LIGHT_COUNT " + std::to_string(LightCount(key)) + "\n";
+    return defines;
+}
+
+Shader& ShaderVariants::request(uint32_t key) {
+    std::unique_ptr<Shader>& shader = variants[key];
+    if (!shader) {
+        shader = std::make_unique<Shader>(vertexPath.c_str(), fragmentPath.c_str(), Shader::Compile::Async, Defines(key));
+    }
+    return *shader;
+}
+
+Shader* ShaderVariants::ready(uint32_t key) {
+    Shader& shader = request(key);
+    return (shader.poll() && shader.isLinked()) ? &shader : nullptr;
+}
@@ -0,0 +1,45 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include "Shader.h"
+
+// Optional features of the model shaders; each set bit becomes a #define
+enum ShaderFeature : uint32_t {
+    ShaderTextured = 1u << 0,        // TEXTURED: sample diffuseMap
+    ShaderSpecular = 1u << 1,        // SPECULAR: add the Phong specular term
+    ShaderPackedVertices = 1u << 2,  // PACKED_VERTICES: decode VertexFormat::Packed attributes
+    ShaderInstanced = 1u << 3        // INSTANCED: per-instance transform and tint from an InstanceBuffer
+};
+
+// Lazily compiled permutations of one vertex/fragment shader pair. A variant
+// is keyed by its feature bits and light count, compiled asynchronously the
+// first time it is requested and kept (and stored in the ProgramCache) from
+// then on.
+class ShaderVariants {
+public:
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath);
+
+    static uint32_t Key(uint32_t features, uint32_t lightCount) { return features | (lightCount << 8); }
+    static uint32_t Features(uint32_t key) { return key & 0xFFu; }
+    static uint32_t LightCount(uint32_t key) { return key >> 8; }
+    // #define lines for a variant
+    static std::string Defines(uint32_t key);
+
+    // The variant's shader, starting its compile if this is the first request
+    Shader& request(uint32_t key);
+    // The variant if it has finished compiling and linked, else nullptr; never blocks
+    // where the driver supports parallel compilation
+    Shader* ready(uint32_t key);
+
+    size_t size() const { return variants.size(); }
+
+private:
+    std::string vertexPath, fragmentPath;
+    std::map<uint32_t, std::unique_ptr<Shader>> variants;
+};
+
+#endif
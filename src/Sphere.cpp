@@ -32,27 +32,21 @@ Sphere::Sphere(unsigned int xSegments, unsigned int ySegments) {
     }
 }
 
-void Sphere::setupSphere() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), &Indices[0], GL_STATIC_DRAW);
+Sphere::~Sphere() {
+    GeometryArena::Free(allocation);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    glEnableVertexAttribArray(2);
+void Sphere::setupSphere() {
+    // Sub-allocate from the shared arena instead of owning a VAO and buffers
+    allocation = GeometryArena::Allocate(VertexFormat::Float32, vertices.size(), Indices.size() * sizeof(unsigned int));
+    GeometryArena::WriteVertices(allocation, 0, vertices.size() * sizeof(Vertex), &vertices[0]);
+    GeometryArena::WriteIndices(allocation, 0, Indices.size() * sizeof(unsigned int), &Indices[0]);
 }
 
-void Sphere::Draw() {
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
+void Sphere::Draw(RenderQueue& queue, DrawState state, float depth) {
+    DrawCommand command{ static_cast<uint32_t>(Indices.size()), 1, allocation.firstIndex(sizeof(unsigned int)), allocation.baseVertex(), 0 };
+    state.format = VertexFormat::Float32;
+    state.page = allocation.page;
+    state.indexType = GL_UNSIGNED_INT;
+    queue.add(state, &command, 1, depth);
 }
\ No newline at end of file
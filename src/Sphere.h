@@ -4,16 +4,22 @@
 #include <vector>
 #include <glm/glm.hpp>
 #include "Shader.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
 
 class Sphere {
-    struct Vertex { glm::vec3 Position, Normal; glm::vec2 TexCoords; };
+    // Same layout as VertexFormat::Float32, so the sphere shares the arena's float VAO
+    struct Vertex { glm::vec3 Position; glm::vec2 TexCoords; glm::vec3 Normal; };
+    static_assert(sizeof(Vertex) == 32, "Sphere vertices must match VertexFormat::Float32");
 public:
-    unsigned int VAO, VBO, EBO;
+    ArenaAllocation allocation;
     std::vector<Vertex> vertices;
     std::vector<unsigned int> Indices;
     
     Sphere(unsigned int xSegments, unsigned int ySegments);
-    void Draw();
+    ~Sphere();
+    // Queues the sphere with the given program, object block and pass
+    void Draw(RenderQueue& queue, DrawState state, float depth);
     void setupSphere();
 };
 
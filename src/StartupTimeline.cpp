@@ -0,0 +1,41 @@
+#include "StartupTimeline.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr int ChartColumns = 48;
+
+double toMs(StartupTimeline::Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+} // namespace
+
+void StartupTimeline::add(const std::string& name, Clock::time_point begin, Clock::time_point end) {
+    spans.push_back({ name, begin, std::max(begin, end) });
+}
+
+void StartupTimeline::print(std::ostream& out) const {
+    if (spans.empty()) return;
+    Clock::time_point first = spans[0].begin, last = spans[0].end;
+    size_t nameWidth = 0;
+    for (const Span& span : spans) {
+        first = std::min(first, span.begin);
+        last = std::max(last, span.end);
+        nameWidth = std::max(nameWidth, span.name.size());
+    }
+    const double totalMs = std::max(toMs(last - first), 1e-3);
+
+    char line[64];
+    std::snprintf(line, sizeof(line), "%.1f", totalMs);
+    out << "Startup timeline (" << line << " ms):\n";
+    for (const Span& span : spans) {
+        const double beginMs = toMs(span.begin - first), endMs = toMs(span.end - first);
+        const int from = std::min(static_cast<int>(beginMs / totalMs * ChartColumns), ChartColumns - 1);
+        const int to = std::max(std::min(static_cast<int>(endMs / totalMs * ChartColumns + 0.5), ChartColumns), from + 1);
+        std::string bar(ChartColumns, '.');
+        std::fill(bar.begin() + from, bar.begin() + to, '#');
+        std::snprintf(line, sizeof(line), "%8.1f - %8.1f ms", beginMs, endMs);
+        out << "  " << span.name << std::string(nameWidth - span.name.size(), ' ') << " |" << bar << "| " << line << "\n";
+    }
+    out.flush();
+}
@@ -0,0 +1,27 @@
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Named spans of startup work, printed as a text chart so overlapping work
+// (e.g. shader compiles running under the model load) is easy to see
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void add(const std::string& name, Clock::time_point begin, Clock::time_point end);
+    // One row per span, scaled from the earliest begin to the latest end
+    void print(std::ostream& out) const;
+
+private:
+    struct Span {
+        std::string name;
+        Clock::time_point begin, end;
+    };
+    std::vector<Span> spans;
+};
+
+#endif
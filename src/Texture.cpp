@@ -5,30 +5,44 @@
 #include <iostream>
 
 GLuint TextureManager::LoadTexture(const std::string& filepath) {
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(filepath.c_str(), &width, &height, &nrChannels, 0);
+    ImageData image = DecodeImage(filepath);
+    GLuint textureID = UploadImage(image);
+    FreeImage(image);
+    return textureID;
+}
+
+ImageData TextureManager::DecodeImage(const std::string& filepath) {
+    stbi_set_flip_vertically_on_load_thread(true);
+    ImageData image;
+    image.pixels = stbi_load(filepath.c_str(), &image.width, &image.height, &image.channels, 0);
     
-    if (!data) {
+    if (!image.pixels) {
         std::cerr << "Failed to load texture: " << filepath << std::endl;
-        return 0;
     }
+    return image;
+}
+
+GLuint TextureManager::UploadImage(const ImageData& image) {
+    if (!image.pixels) return 0;
 
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
     
-    GLenum format = (nrChannels == 3) ? GL_RGB : GL_RGBA;
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    GLenum format = (image.channels == 3) ? GL_RGB : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
     glGenerateMipmap(GL_TEXTURE_2D);
     
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    
-    stbi_image_free(data);
     return textureID;
 }
 
+void TextureManager::FreeImage(ImageData& image) {
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
 void TextureManager::DeleteTexture(GLuint textureID) {
     glDeleteTextures(1, &textureID);
 }
\ No newline at end of file
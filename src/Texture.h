@@ -2,8 +2,19 @@
 #include <GL/glew.h>
 #include <string>
 
+// Decoded pixels waiting to be uploaded
+struct ImageData {
+    int width = 0, height = 0, channels = 0;
+    unsigned char* pixels = nullptr;
+};
+
 class TextureManager {
 public:
     static GLuint LoadTexture(const std::string& filepath);
+    // Decode only; safe to call from a worker thread. Release with FreeImage.
+    static ImageData DecodeImage(const std::string& filepath);
+    // Creates the mipmapped GL texture; needs the context thread
+    static GLuint UploadImage(const ImageData& image);
+    static void FreeImage(ImageData& image);
     static void DeleteTexture(GLuint textureID);
 };
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "TriangleBvh.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define TRIANGLE_SSE 1
+#endif
+
+namespace {
+
+// One kernel call's worth; larger leaves only occur where the builder cannot split
+constexpr uint32_t MaxLeafTriangles = 4;
+
+// Slab test against a node box; infinity for a miss
+float rayBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    const glm::vec3 t0 = (node.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (node.max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    const float entry = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+    const float exit = std::min({ tFar.x, tFar.y, tFar.z, maxDistance });
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+void TriangleBvh::build(std::vector<glm::vec3> vertexPositions, const std::vector<uint32_t>& indices) {
+    positions = std::move(vertexPositions);
+    const size_t count = indices.size() / 3;
+    std::vector<glm::vec3> boxMin(count), boxMax(count);
+    for (size_t t = 0; t < count; ++t) {
+        const glm::vec3& a = positions[indices[3 * t]];
+        const glm::vec3& b = positions[indices[3 * t + 1]];
+        const glm::vec3& c = positions[indices[3 * t + 2]];
+        boxMin[t] = glm::min(a, glm::min(b, c));
+        boxMax[t] = glm::max(a, glm::max(b, c));
+    }
+    BvhBuilder::Build(boxMin.data(), boxMax.data(), count, MaxLeafTriangles, nodes, triangleIds);
+
+    // Corners in leaf order, so a leaf reads one contiguous run
+    corners.resize(3 * count);
+    for (size_t i = 0; i < count; ++i) {
+        std::copy_n(&indices[3 * static_cast<size_t>(triangleIds[i])], 3, &corners[3 * i]);
+    }
+}
+
+size_t TriangleBvh::memoryBytes() const {
+    return nodes.capacity() * sizeof(BvhNode) + positions.capacity() * sizeof(glm::vec3) +
+           (corners.capacity() + triangleIds.capacity()) * sizeof(uint32_t);
+}
+
+bool TriangleBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const {
+    return traverse<false>(origin, direction, maxDistance, hit);
+}
+
+bool TriangleBvh::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    Hit hit;
+    return traverse<true>(origin, direction, maxDistance, hit);
+}
+
+template <bool AnyHit>
+bool TriangleBvh::traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const {
+    hit.distance = maxDistance;
+    if (nodes.empty()) return false;
+    const glm::vec3 inverseDirection = BvhBuilder::InverseDirection(direction);
+
+    // Nearest child first; entries remember their box entry distance so they
+    // can be dropped once a closer triangle has been found
+    struct Entry { uint32_t node; float entry; };
+    Entry stack[BvhBuilder::MaxDepth];
+    int top = 0;
+    const float rootEntry = rayBox(nodes[0], origin, inverseDirection, maxDistance);
+    if (rootEntry == std::numeric_limits<float>::infinity()) return false;
+    stack[top++] = { 0, rootEntry };
+    bool found = false;
+    while (top > 0) {
+        const Entry current = stack[--top];
+        if (current.entry > hit.distance) continue;
+        const BvhNode& node = nodes[current.node];
+        if (node.count > 0) {
+            if (intersectLeaf(node.first, node.count, origin, direction, hit)) {
+                found = true;
+                if (AnyHit) return true;
+            }
+            continue;
+        }
+        float near = rayBox(nodes[node.first], origin, inverseDirection, hit.distance);
+        float far = rayBox(nodes[node.first + 1], origin, inverseDirection, hit.distance);
+        uint32_t nearNode = node.first, farNode = node.first + 1;
+        if (far < near) {
+            std::swap(near, far);
+            std::swap(nearNode, farNode);
+        }
+        if (far != std::numeric_limits<float>::infinity()) stack[top++] = { farNode, far };
+        if (near != std::numeric_limits<float>::infinity()) stack[top++] = { nearNode, near };
+    }
+    return found;
+}
+
+bool TriangleBvh::intersectLeaf(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const {
+    bool found = false;
+    for (uint32_t base = first; base < first + count; base += 4) {
+        // Gather four triangles as first corner plus two edges, one array per
+        // component; a short batch repeats its last triangle
+        const uint32_t lanes = std::min(4u, first + count - base);
+        alignas(16) float v0[3][4], e1[3][4], e2[3][4];
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            const uint32_t* corner = &corners[3 * static_cast<size_t>(base + std::min(lane, lanes - 1))];
+            const glm::vec3& a = positions[corner[0]];
+            const glm::vec3 ab = positions[corner[1]] - a, ac = positions[corner[2]] - a;
+            for (int axis = 0; axis < 3; ++axis) {
+                v0[axis][lane] = a[axis];
+                e1[axis][lane] = ab[axis];
+                e2[axis][lane] = ac[axis];
+            }
+        }
+
+        // Moller-Trumbore, two-sided
+        alignas(16) float t[4], u[4], v[4];
+        int mask = 0;
+#ifdef TRIANGLE_SSE
+        const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+        const __m128 e1x = _mm_load_ps(e1[0]), e1y = _mm_load_ps(e1[1]), e1z = _mm_load_ps(e1[2]);
+        const __m128 e2x = _mm_load_ps(e2[0]), e2y = _mm_load_ps(e2[1]), e2z = _mm_load_ps(e2[2]);
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        const __m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_load_ps(v0[0]));
+        const __m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_load_ps(v0[1]));
+        const __m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_load_ps(v0[2]));
+        const __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        const __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+        const __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 inside = _mm_cmpneq_ps(det, zero);
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(uu, zero));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(vv, zero));
+        inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(tt, zero));
+        inside = _mm_and_ps(inside, _mm_cmple_ps(tt, _mm_set1_ps(hit.distance)));
+        mask = _mm_movemask_ps(inside);
+        _mm_store_ps(t, tt);
+        _mm_store_ps(u, uu);
+        _mm_store_ps(v, vv);
+#else
+        for (int lane = 0; lane < 4; ++lane) {
+            const glm::vec3 edge1(e1[0][lane], e1[1][lane], e1[2][lane]), edge2(e2[0][lane], e2[1][lane], e2[2][lane]);
+            const glm::vec3 p = glm::cross(direction, edge2);
+            const float det = glm::dot(edge1, p);
+            if (det == 0.0f) continue;
+            const float inverseDet = 1.0f / det;
+            const glm::vec3 s = origin - glm::vec3(v0[0][lane], v0[1][lane], v0[2][lane]);
+            const glm::vec3 q = glm::cross(s, edge1);
+            u[lane] = glm::dot(s, p) * inverseDet;
+            v[lane] = glm::dot(direction, q) * inverseDet;
+            t[lane] = glm::dot(edge2, q) * inverseDet;
+            if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && t[lane] >= 0.0f && t[lane] <= hit.distance) mask |= 1 << lane;
+        }
+#endif
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            if (!(mask & (1 << lane)) || t[lane] > hit.distance) continue;
+            hit = { triangleIds[base + lane], t[lane], u[lane], v[lane] };
+            found = true;
+        }
+    }
+    return found;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef TRIANGLEBVH_H
+#define TRIANGLEBVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BvhBuilder.h"
+
+// Binned SAH hierarchy over an indexed triangle mesh, for ray picking and
+// line-of-sight tests. Leaves hold up to four triangles, which the ray kernel
+// intersects together (SSE where available). Triangles are stored as index
+// triples into a shared position array, 16 bytes per triangle with its ID.
+class TriangleBvh {
+public:
+    struct Hit {
+        uint32_t triangle;  // index into the triangle list given to build()
+        float distance;     // in units of the ray direction
+        float u, v;         // barycentrics of the second and third corner
+    };
+
+    // Takes ownership of the positions and the triangle list (3 indices each)
+    void build(std::vector<glm::vec3> positions, const std::vector<uint32_t>& indices);
+    bool empty() const { return nodes.empty(); }
+    size_t triangleCount() const { return triangleIds.size(); }
+    size_t memoryBytes() const;
+
+    // Closest two-sided hit with 0 <= distance <= maxDistance
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+    // Any hit within maxDistance, e.g. for line of sight; stops at the first one
+    bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+private:
+    std::vector<BvhNode> nodes;
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> corners;      // 3 per triangle, in leaf order
+    std::vector<uint32_t> triangleIds;  // leaf order -> build() order
+
+    template <bool AnyHit>
+    bool traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+    // Closest hit among triangles [first, first + count) nearer than hit.distance
+    bool intersectLeaf(uint32_t first, uint32_t count, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "UniformBuffers.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Room for the frame block and this many object blocks before the buffer grows
+constexpr size_t InitialObjects = 256;
+
+GLuint buffer = 0;
+size_t capacity = 0;      // bytes of the current GPU storage
+size_t cursor = 0;        // next free offset in this frame's blocks
+size_t uploaded = 0;      // blocks below this offset are already in the GPU storage
+size_t alignment = 256;   // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+FrameUniforms lastFrame{};
+std::vector<uint8_t> shadow;  // this frame's blocks; written on the CPU, uploaded by Upload
+
+size_t slotBytes(size_t size) { return (size + alignment - 1) / alignment * alignment; }
+
+// Detaches the current storage (draws already queued keep reading it) and
+// allocates a fresh one of capacity bytes, with nothing uploaded yet
+void orphan() {
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBindBufferRange(GL_UNIFORM_BUFFER, UniformBuffers::FrameBinding, buffer, 0, sizeof(FrameUniforms));
+    uploaded = 0;
+}
+
+void create() {
+    GLint offsetAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    if (offsetAlignment > 0) alignment = static_cast<size_t>(offsetAlignment);
+    capacity = slotBytes(sizeof(FrameUniforms)) + InitialObjects * slotBytes(sizeof(ObjectUniforms));
+    shadow.resize(capacity);
+    glGenBuffers(1, &buffer);
+    orphan();
+    std::memcpy(shadow.data(), &lastFrame, sizeof(FrameUniforms));
+    cursor = slotBytes(sizeof(FrameUniforms));
+}
+
+} // namespace
+
+void UniformBuffers::BindBlocks(GLuint program) {
+    const GLuint frameIndex = glGetUniformBlockIndex(program, "Frame");
+    if (frameIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, frameIndex, FrameBinding);
+    const GLuint objectIndex = glGetUniformBlockIndex(program, "Object");
+    if (objectIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, objectIndex, ObjectBinding);
+    const GLuint materialIndex = glGetUniformBlockIndex(program, "Materials");
+    if (materialIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, materialIndex, MaterialBinding);
+}
+
+void UniformBuffers::BeginFrame(const FrameUniforms& frame) {
+    if (buffer == 0) create();
+    lastFrame = frame;
+    capacity = shadow.size();  // a frame that outgrew the storage sizes the next one
+    orphan();
+    std::memcpy(shadow.data(), &lastFrame, sizeof(FrameUniforms));
+    cursor = slotBytes(sizeof(FrameUniforms));
+}
+
+const FrameUniforms& UniformBuffers::CurrentFrame() { return lastFrame; }
+
+size_t UniformBuffers::WriteObject(const glm::mat4& model, const glm::vec3& positionOffset, const glm::vec3& positionScale, uint32_t materialIndex) {
+    if (buffer == 0) create();
+    const size_t slot = slotBytes(sizeof(ObjectUniforms));
+    if (cursor + slot > shadow.size()) shadow.resize(shadow.size() * 2);
+
+    ObjectUniforms object{};
+    object.model = model;
+    object.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+    object.positionOffset = glm::vec4(positionOffset, 0.0f);
+    object.positionScale = glm::vec4(positionScale, 0.0f);
+    object.materialIndex = materialIndex;
+    const size_t offset = cursor;
+    std::memcpy(shadow.data() + offset, &object, sizeof(ObjectUniforms));
+    cursor += slot;
+    return offset;
+}
+
+void UniformBuffers::Upload() {
+    if (buffer == 0 || uploaded == cursor) return;
+    // More blocks than the storage holds: reallocate at the shadow's size and
+    // send the whole frame again, so offsets handed out earlier stay valid
+    if (cursor > capacity) {
+        capacity = shadow.size();
+        orphan();
+    }
+    // Ranges are written once per storage, so nothing the GPU reads is
+    // overwritten and the map needs no synchronization
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    void* target = glMapBufferRange(GL_UNIFORM_BUFFER, uploaded, cursor - uploaded,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (target) {
+        std::memcpy(target, shadow.data() + uploaded, cursor - uploaded);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    } else {
+        glBufferSubData(GL_UNIFORM_BUFFER, uploaded, cursor - uploaded, shadow.data() + uploaded);
+    }
+    uploaded = cursor;
+}
+
+void UniformBuffers::BindObject(size_t offset) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBinding, buffer, offset, sizeof(ObjectUniforms));
+}
+
+void UniformBuffers::Shutdown() {
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    capacity = 0;
+    cursor = 0;
+    uploaded = 0;
+    shadow.clear();
+    shadow.shrink_to_fit();
+}
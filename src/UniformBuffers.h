@@ -0,0 +1,74 @@
+#ifndef UNIFORMBUFFERS_H
+#define UNIFORMBUFFERS_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// std140 mirror of the shaders' Frame block
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewPos;     // xyz camera position
+    glm::vec4 lightPos[4];    // xyz, UniformBuffers::MaxLights entries
+    glm::vec4 lightColor[4];  // rgb
+    uint32_t lightCount;      // entries in use; shaders are compiled for a fixed count
+    uint32_t padding[3];
+};
+
+// std140 mirror of the shaders' Object block
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;    // inverse transpose of model's upper 3x3, stored as columns of a mat4
+    glm::vec4 positionOffset;  // xyz, vertex format decode (see VertexLayout)
+    glm::vec4 positionScale;   // xyz
+    uint32_t materialIndex;    // for instanced draws, which cannot pass it as baseInstance
+    uint32_t padding[3];
+};
+
+// std140 mirror of the shaders' Materials block. A Model writes one per
+// GeometryArena::MaxDrawMaterials material IDs, back to back, once.
+struct MaterialUniforms {
+    glm::vec4 diffuse[128];   // rgb Kd, GeometryArena::MaxDrawMaterials entries
+    glm::vec4 specular[128];  // rgb Ks, a the shininess (Ns)
+};
+
+// Per-frame and per-object shader constants in one streamed uniform buffer.
+// BeginFrame writes the frame block and binds it once; each WriteObject
+// appends an object block to a CPU copy of the frame's blocks and returns its
+// offset for BindObject. Upload sends everything written since the last call
+// to the GPU with one map, so a frame costs one buffer write however many
+// objects it draws; RenderQueue::flush calls it before submitting. Blocks
+// written during a frame stay valid until the next BeginFrame.
+// All calls need the GL context thread.
+class UniformBuffers {
+public:
+    // Binding points the Frame and Object blocks are attached to
+    static constexpr GLuint FrameBinding = 0;
+    static constexpr GLuint ObjectBinding = 1;
+    static constexpr GLuint MaterialBinding = 2;
+    // Size of the Frame block's light arrays, MAX_LIGHTS in the shaders
+    static constexpr uint32_t MaxLights = 4;
+
+    // Attaches whichever of the blocks the program declares to their binding points
+    static void BindBlocks(GLuint program);
+
+    static void BeginFrame(const FrameUniforms& frame);
+    // The frame block written by the last BeginFrame
+    static const FrameUniforms& CurrentFrame();
+    // Appends an object block and returns its offset for BindObject; nothing
+    // reaches the GPU until Upload
+    static size_t WriteObject(const glm::mat4& model, const glm::vec3& positionOffset = glm::vec3(0.0f),
+                              const glm::vec3& positionScale = glm::vec3(1.0f), uint32_t materialIndex = 0);
+    // Uploads the blocks written since the last call; needed before drawing with them
+    static void Upload();
+    static void BindObject(size_t offset);
+
+    // Deletes the buffer; call before the context goes away
+    static void Shutdown();
+};
+
+static_assert(sizeof(FrameUniforms::lightPos) / sizeof(glm::vec4) == UniformBuffers::MaxLights, "Frame light arrays must hold MaxLights entries");
+
+#endif
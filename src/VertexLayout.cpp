@@ -0,0 +1,120 @@
+#include "VertexLayout.h"
+#include <GL/glew.h>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+inline uint16_t toUnorm16(float v) {
+    v = std::fmin(std::fmax(v, 0.0f), 1.0f);
+    return static_cast<uint16_t>(std::lround(v * 65535.0f));
+}
+
+inline int16_t toSnorm16(float v) {
+    v = std::fmin(std::fmax(v, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::lround(v * 32767.0f));
+}
+
+inline float signNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+// Maps a unit vector onto the octahedron and unfolds it into [-1, 1]^2
+void octEncode(float x, float y, float z, float& u, float& v) {
+    const float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+    if (l1 == 0.0f) {
+        u = v = 0.0f;
+        return;
+    }
+    u = x / l1;
+    v = y / l1;
+    if (z < 0.0f) {
+        const float pu = u;
+        u = (1.0f - std::fabs(v)) * signNotZero(pu);
+        v = (1.0f - std::fabs(pu)) * signNotZero(v);
+    }
+}
+
+inline glm::vec3 extentOf(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 extent = boundsMax - boundsMin;
+    // Flat axes still need a non-zero scale
+    for (int i = 0; i < 3; ++i) {
+        if (extent[i] <= 0.0f) extent[i] = 1.0f;
+    }
+    return extent;
+}
+
+} // namespace
+
+size_t VertexLayout::Stride(VertexFormat format) {
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : 8 * sizeof(float);
+}
+
+uint16_t VertexLayout::FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (((bits >> 23) & 0xffu) == 0xffu) {  // Inf / NaN
+        return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 31) return static_cast<uint16_t>(sign | 0x7c00u);  // overflow to Inf
+    if (exponent <= 0) {
+        if (exponent < -10) return static_cast<uint16_t>(sign);  // underflow to zero
+        mantissa |= 0x800000u;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u) ++half;  // round to nearest
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000u) ++half;  // round to nearest, carries into the exponent correctly
+    return static_cast<uint16_t>(half);
+}
+
+void VertexLayout::Pack(const float* src, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, PackedVertex* dst) {
+    const glm::vec3 extent = extentOf(boundsMin, boundsMax);
+    for (size_t i = 0; i < count; ++i, src += 8) {
+        PackedVertex& out = dst[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            out.position[axis] = toUnorm16((src[axis] - boundsMin[axis]) / extent[axis]);
+        }
+        out.position[3] = 0;
+        out.texCoord[0] = FloatToHalf(src[3]);
+        out.texCoord[1] = FloatToHalf(src[4]);
+
+        float u, v;
+        octEncode(src[5], src[6], src[7], u, v);
+        out.normal[0] = toSnorm16(u);
+        out.normal[1] = toSnorm16(v);
+    }
+}
+
+glm::vec3 VertexLayout::PositionOffset(VertexFormat format, const glm::vec3& boundsMin) {
+    return format == VertexFormat::Packed ? boundsMin : glm::vec3(0.0f);
+}
+
+glm::vec3 VertexLayout::PositionScale(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    return format == VertexFormat::Packed ? extentOf(boundsMin, boundsMax) : glm::vec3(1.0f);
+}
+
+void VertexLayout::SetupAttributes(VertexFormat format, size_t baseOffset) {
+    const GLsizei stride = static_cast<GLsizei>(Stride(format));
+    auto offset = [baseOffset](size_t bytes) { return reinterpret_cast<void*>(baseOffset + bytes); };
+
+    if (format == VertexFormat::Packed) {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, offset(offsetof(PackedVertex, position)));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, offset(offsetof(PackedVertex, texCoord)));
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, offset(offsetof(PackedVertex, normal)));
+    } else {
+        // Vertex positions
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offset(0));
+        // Texture coordinates
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, offset(3 * sizeof(float)));
+        // Normals
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, offset(5 * sizeof(float)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
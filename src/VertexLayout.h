@@ -0,0 +1,41 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// GPU vertex formats a Model can upload
+enum class VertexFormat : uint32_t {
+    Float32 = 0,  // 32 bytes: float position, float UV, float normal
+    Packed = 1    // 16 bytes: see PackedVertex
+};
+
+// Compact vertex, decoded in vertex_shader.glsl
+struct PackedVertex {
+    uint16_t position[4];  // unorm16 within the mesh AABB, [3] is padding
+    uint16_t texCoord[2];  // half floats, so tiling UVs outside [0, 1] survive
+    int16_t normal[2];     // octahedral-encoded snorm16
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+class VertexLayout {
+public:
+    static size_t Stride(VertexFormat format);
+
+    // Encodes count interleaved 8-float vertices (position, UV, normal)
+    static void Pack(const float* src, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, PackedVertex* dst);
+
+    // Uniforms that map the packed position back into model space
+    // (identity for Float32)
+    static glm::vec3 PositionOffset(VertexFormat format, const glm::vec3& boundsMin);
+    static glm::vec3 PositionScale(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Describes attributes 0 (position), 1 (UV) and 2 (normal) of the bound
+    // VAO for vertices starting at baseOffset in the bound GL_ARRAY_BUFFER
+    static void SetupAttributes(VertexFormat format, size_t baseOffset = 0);
+
+    static uint16_t FloatToHalf(float value);
+};
+
+#endif
@@ -3,10 +3,26 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
 #include "Model.h"
 #include "Shader.h"
+#include "ShaderVariants.h"
 #include "Sphere.h"
+#include "RenderQueue.h"
 #include "Camera.h"
+#include "GeometryArena.h"
+#include "UniformBuffers.h"
+#include "StartupTimeline.h"
+#include "InstanceBuffer.h"
+#include "FrustumCulling.h"
+#include "InstanceBvh.h"
+#include "OcclusionCuller.h"
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
 
@@ -14,8 +30,24 @@
 float deltaTime = 0.0f;    // Time between current frame and last frame
 float lastFrame = 0.0f;    // Time of last frame
 float orbitRadius = 5.0f;  // Radius of the light's orbital path
+const double uploadBudgetMs = 4.0;  // Per-frame time spent uploading a progressively loaded model
+const uint32_t lightCount = 1;      // Lights in the Frame block; the orbiting sphere
+
+int main(int argc, char** argv) {
+    // Command line switches for comparing model load paths
+    ModelOptions modelOptions;
+    size_t crowdSize = 0;  // instances of the model drawn instanced; 0 draws it once
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--packed") == 0) modelOptions.vertexFormat = VertexFormat::Packed;
+        else if (std::strcmp(argv[i], "--no-optimize") == 0) modelOptions.optimizeMesh = false;
+        else if (std::strcmp(argv[i], "--progressive") == 0) modelOptions.progressive = true;
+        else if (std::strcmp(argv[i], "--keep-all") == 0) modelOptions.retention = RetentionPolicy::KeepAll;
+        else if (std::strcmp(argv[i], "--keep-nothing") == 0) modelOptions.retention = RetentionPolicy::KeepNothing;
+        else if (std::strcmp(argv[i], "--pick") == 0) modelOptions.buildPickBvh = true;
+        else if (std::strcmp(argv[i], "--crowd") == 0 && i + 1 < argc) crowdSize = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--occlusion") == 0) modelOptions.buildOccluder = true;
+    }
 
-int main() {
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -43,14 +75,70 @@ int main() {
         return -1;
     }
 
-    // Create and compile shaders
-    Shader shader("../src/shaders/vertex_shader.glsl", "../src/shaders/fragment_shader.glsl");          // Main shader for the model
-    Shader sphereShader("../src/shaders/sphere_vertex.glsl", "../src/shaders/sphere_fragment.glsl");    // Shader for the light sphere
+    // Issue both shader compiles up front; the driver works on them while the model loads.
+    // The model's other variants compile on demand, with this full-featured one standing in.
+    ShaderVariants modelShaders("../src/shaders/vertex_shader.glsl", "../src/shaders/fragment_shader.glsl");  // Shader variants for the model
+    const uint32_t packedFeature = (modelOptions.vertexFormat == VertexFormat::Packed) ? static_cast<uint32_t>(ShaderPackedVertices) : 0u;
+    Shader& shader = modelShaders.request(ShaderVariants::Key(ShaderTextured | ShaderSpecular | packedFeature, lightCount));
+    Shader sphereShader("../src/shaders/sphere_vertex.glsl", "../src/shaders/sphere_fragment.glsl", Shader::Compile::Async);    // Shader for the light sphere
     
-    // Load 3D model and create sphere
-    Model womanModel("assets/woman1.obj", "assets/woman1.mtl");  // Load the woman model with its material
+    // Load 3D model and create sphere. The model always parses on its loader
+    // thread, so this thread can poll the shaders while it waits and each
+    // compile's end is recorded when the driver reports it, not after the load.
+    StartupTimeline timeline;
+    const auto modelStart = StartupTimeline::Clock::now();
+    ModelOptions loadOptions = modelOptions;
+    loadOptions.progressive = true;
+    Model womanModel("assets/woman1.obj", "assets/woman1.mtl", loadOptions);  // Load the woman model with its material
+    if (!modelOptions.progressive) {
+        // Blocking load: everything is resident before the first frame
+        while (!womanModel.Upload(uploadBudgetMs)) {
+            shader.poll();
+            sphereShader.poll();
+            std::this_thread::yield();  // the loader thread may still be parsing
+        }
+    }
+    const auto sphereStart = StartupTimeline::Clock::now();
     Sphere sphere(20, 20);  // Create a sphere for the light source
     sphere.setupSphere();   // Setup sphere's VAO, VBO, and EBO
+    timeline.add("model load", modelStart, sphereStart);
+    timeline.add("sphere setup", sphereStart, StartupTimeline::Clock::now());
+
+    // Both programs are needed from the first frame on
+    shader.wait();
+    sphereShader.wait();
+    timeline.add("model shader", shader.getCompileStart(), shader.getCompileEnd());
+    timeline.add("sphere shader", sphereShader.getCompileStart(), sphereShader.getCompileEnd());
+    sphereShader.use();
+    sphereShader.setVec3("objectColor", glm::vec3(1.0f));  // White color for light source; program state, set once
+
+    // A square grid of the model, one unit apart, for --crowd. Once the model's
+    // bounds are known only the instances inside the frustum are uploaded.
+    InstanceBuffer crowd;
+    std::vector<glm::mat4> crowdTransforms(crowdSize), visibleTransforms;
+    AabbList crowdBounds;                 // world space, filled once the model is resident
+    InstanceBvh crowdBvh;                 // over crowdBounds; the crowd never moves, so it is never refitted
+    std::vector<uint32_t> crowdVisible;
+    if (crowdSize > 0) {
+        const size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(crowdSize))));
+        for (size_t i = 0; i < crowdSize; ++i) {
+            crowdTransforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(float(i % side), 0.0f, -float(i / side)));
+        }
+        crowd.update(crowdTransforms.data(), nullptr, crowdSize);
+    }
+
+    // With --occlusion the model's occluder mesh (with --crowd, that of the
+    // nearest visible instances) is rasterized on the CPU each frame, and the
+    // sphere, the model and the crowd are tested against it before drawing
+    const size_t crowdOccluders = 8;
+    std::vector<std::pair<float, uint32_t>> crowdNearest;  // squared distance and index of each visible instance, reused
+    std::unique_ptr<OcclusionCuller> occlusion;
+    if (modelOptions.buildOccluder) occlusion = std::make_unique<OcclusionCuller>();
+
+    RenderQueue renderQueue;   // Everything drawn in a frame, sorted by state before submission
+    float statsReportTime = 0.0f;
+    bool residentReported = false;  // memory and startup timeline printed once the model is resident
+    bool mouseWasDown = false;      // --pick fires on the press edge
     
     float rotationSpeed = 0.5f;  // Speed of light's orbital rotation
 
@@ -80,59 +168,149 @@ int main() {
         if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) rotationSpeed += 0.05f;  // Increase rotation speed
         if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) rotationSpeed -= 0.05f;  // Decrease rotation speed
 
+        // Stream in whatever the loader thread has finished, without stalling the frame
+        if (womanModel.Upload(uploadBudgetMs) && !residentReported) {
+            ModelMemory memory = womanModel.getResidentBytes();
+            std::cout << "Model resident: " << memory.cpuBytes / 1024 << " KB CPU, " << memory.gpuBytes / 1024 << " KB GPU" << std::endl;
+            if (modelOptions.progressive) timeline.add("model resident", modelStart, StartupTimeline::Clock::now());
+            timeline.print(std::cout);
+            residentReported = true;
+        }
+
         // Clear the screen
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);  // Dark gray background
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Create view and projection matrices
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+        glm::mat4 projection = camera.GetProjectionMatrix(800.0f / 600.0f);
 
-        // Draw the orbiting light sphere
-        sphereShader.use();
         static float orbitAngle = 0.0f;
         orbitAngle += rotationSpeed * deltaTime;  // Update orbit angle
         
         // Calculate light position in orbit
         glm::vec3 lightPos(orbitRadius * cos(orbitAngle), 0.0f, orbitRadius * sin(orbitAngle));
 
-        // Set uniforms for sphere shader
-        sphereShader.setMat4("projection", projection);
-        sphereShader.setMat4("view", view);
-        sphereShader.setVec3("objectColor", glm::vec3(1.0f));  // White color for light source
+        // Camera and light go into the Frame block once, shared by every shader
+        FrameUniforms frame{};
+        frame.view = view;
+        frame.projection = projection;
+        frame.viewPos = glm::vec4(camera.Position, 1.0f);  // Camera position for specular lighting
+        frame.lightPos[0] = glm::vec4(lightPos, 1.0f);
+        frame.lightColor[0] = glm::vec4(1.0f);  // White light
+        frame.lightCount = lightCount;
+        UniformBuffers::BeginFrame(frame);
+
+        // World-space planes for everything culled here; Model::Draw culls its groups itself
+        const Frustum frustum = Frustum::FromMatrix(projection * view);
 
-        // Draw sphere in wireframe mode
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::scale(model, glm::vec3(0.05f));  // Scale the model down
+        if (crowdSize > 0) {
+            glm::vec3 boundsMin, boundsMax;
+            if (crowdBounds.size() == 0 && womanModel.isResident() && womanModel.getBounds(boundsMin, boundsMax)) {
+                crowdBounds.resize(crowdSize);
+                for (size_t i = 0; i < crowdSize; ++i) {
+                    glm::vec3 instanceMin, instanceMax;
+                    FrustumCuller::TransformBounds(crowdTransforms[i] * model, boundsMin, boundsMax, instanceMin, instanceMax);
+                    crowdBounds.set(i, instanceMin, instanceMax);
+                }
+                crowdBvh.build(crowdBounds);
+            }
+            crowdVisible.clear();
+            crowdBvh.cull(frustum, crowdVisible);
+        }
+
+        if (occlusion) {
+            occlusion->beginFrame(projection * view, camera.NearPlane);
+            if (crowdSize > 0) {
+                // The nearest instances hide the most; which of them comes first does not matter
+                crowdNearest.clear();
+                for (uint32_t i : crowdVisible) {
+                    const glm::vec3 offset = glm::vec3(crowdBounds.minX[i] + crowdBounds.maxX[i], crowdBounds.minY[i] + crowdBounds.maxY[i],
+                                                       crowdBounds.minZ[i] + crowdBounds.maxZ[i]) * 0.5f - camera.Position;
+                    crowdNearest.emplace_back(glm::dot(offset, offset), i);
+                }
+                const size_t occluderCount = std::min(crowdOccluders, crowdNearest.size());
+                std::nth_element(crowdNearest.begin(), crowdNearest.begin() + occluderCount, crowdNearest.end());
+                for (size_t i = 0; i < occluderCount; ++i) {
+                    womanModel.DrawOccluder(*occlusion, crowdTransforms[crowdNearest[i].second] * model, camera, projection);
+                }
+            } else {
+                womanModel.DrawOccluder(*occlusion, model, camera, projection);
+            }
+            occlusion->rasterize();
+        }
+
+        // Queue the orbiting light sphere in wireframe mode, if it is in view
         glm::mat4 sphereModel = glm::mat4(1.0f);
         sphereModel = glm::translate(sphereModel, lightPos);
         sphereModel = glm::scale(sphereModel, glm::vec3(0.5f));  // Scale the sphere
-        sphereShader.setMat4("model", sphereModel);
-        sphere.Draw();
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-        // Draw the woman model with lighting
-        shader.use();
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-        shader.setVec3("viewPos", camera.Position);  // Camera position for specular lighting
-        shader.setVec3("lightColor", glm::vec3(1.0f));  // White light
-        shader.setVec3("lightPos", lightPos);  // Update light position
-        
-        // Set model matrix and draw
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(0.05f));  // Scale the model down
-        shader.setMat4("model", model);
-        womanModel.Draw(shader);
+        if (frustum.intersectsSphere(lightPos, 0.5f) && (!occlusion || occlusion->isVisible(glm::vec3(-1.0f), glm::vec3(1.0f), sphereModel))) {
+            DrawState sphereState;
+            sphereState.pass = RenderPass::Wireframe;
+            sphereState.program = sphereShader.ID;
+            sphereState.objectOffset = UniformBuffers::WriteObject(sphereModel);
+            sphere.Draw(renderQueue, sphereState, glm::length(lightPos - camera.Position));
+        }
+
+        // Queue the woman model with lighting; Draw writes its Object block
+        if (crowdSize > 0) {
+            if (crowdBvh.size() > 0) {
+                visibleTransforms.clear();
+                for (uint32_t i : crowdVisible) {
+                    const glm::vec3 instanceMin(crowdBounds.minX[i], crowdBounds.minY[i], crowdBounds.minZ[i]);
+                    const glm::vec3 instanceMax(crowdBounds.maxX[i], crowdBounds.maxY[i], crowdBounds.maxZ[i]);
+                    if (!occlusion || occlusion->isVisible(instanceMin, instanceMax, glm::mat4(1.0f))) visibleTransforms.push_back(crowdTransforms[i]);
+                }
+                crowd.update(visibleTransforms.data(), nullptr, visibleTransforms.size());
+            }
+            womanModel.DrawInstanced(renderQueue, modelShaders, model, crowd);  // one draw per material group
+        } else {
+            glm::vec3 boundsMin, boundsMax;
+            if (!occlusion || !womanModel.getBounds(boundsMin, boundsMax) || occlusion->isVisible(boundsMin, boundsMax, model)) {
+                womanModel.Draw(renderQueue, modelShaders, model, camera, projection, 600.0f);  // LOD from screen-space error, groups and meshlets culled
+            }
+        }
+
+        // With --pick, a left click reports the triangle under the view centre (the cursor is captured)
+        const bool mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (modelOptions.buildPickBvh && mouseDown && !mouseWasDown) {
+            PickHit hit;
+            const auto pickStart = std::chrono::steady_clock::now();
+            const bool picked = womanModel.Pick(model, camera.Position, camera.Front, camera.FarPlane, hit);
+            const std::chrono::duration<double, std::milli> pickTime = std::chrono::steady_clock::now() - pickStart;
+            if (picked) {
+                std::cout << "Picked material " << hit.materialId << ", triangle " << hit.triangle << " at distance " << hit.distance
+                          << " (barycentric " << hit.barycentric.x << ", " << hit.barycentric.y << ") in " << pickTime.count() << " ms" << std::endl;
+            } else {
+                std::cout << "Picked nothing in " << pickTime.count() << " ms" << std::endl;
+            }
+        }
+        mouseWasDown = mouseDown;
+
+        // Sort and submit everything queued this frame
+        renderQueue.flush(camera.FarPlane);
+        if (currentFrame - statsReportTime >= 5.0f) {
+            const RenderQueueStats& stats = renderQueue.getStats();
+            std::cout << "Render queue: " << stats.packets << " packets, " << stats.draws << " draws, " << stats.stateChanges
+                      << " state changes (" << stats.stateChangesSaved << " redundant binds skipped)" << std::endl;
+            if (occlusion) {
+                const OcclusionStats& occlusionStats = occlusion->getStats();
+                std::cout << "Occlusion: " << occlusionStats.occluderTriangles << " occluder triangles in " << occlusionStats.rasterMs
+                          << " ms, " << occlusionStats.culled << " of " << occlusionStats.tested << " objects culled" << std::endl;
+            }
+            statsReportTime = currentFrame;
+        }
 
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    // Cleanup
-    glDeleteVertexArrays(1, &sphere.VAO);
-    glDeleteBuffers(1, &sphere.VBO);
-    glDeleteBuffers(1, &sphere.EBO);
+    // Cleanup: the sphere and model return their ranges on destruction, the pages go now
+    GeometryArena::Shutdown();
+    UniformBuffers::Shutdown();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -4,16 +4,41 @@ out vec4 FragColor;
 in vec2 TexCoord;
 in vec3 FragPos;
 in vec3 Normal;
+flat in uint MaterialIndex;
+#ifdef INSTANCED
+flat in vec3 Tint;
+#endif
 
-uniform vec3 lightPos;    // Sphere's position (passed from CPU)
-uniform vec3 lightColor;  // Sphere's light color (e.g., white)
-uniform vec3 viewPos;     // Camera position
+// Per-frame constants, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;                // Camera position
+    vec4 lightPos[MAX_LIGHTS];   // Light positions (the sphere's is the first)
+    vec4 lightColor[MAX_LIGHTS]; // Light colors (e.g., white)
+    uint lightCount;
+};
+
+#ifdef TEXTURED
 uniform sampler2D diffuseMap;
+#endif
+
+// MTL constants, indexed per draw; see MaterialUniforms
+layout(std140) uniform Materials {
+    vec4 materialDiffuse[128];  // Kd of untextured materials; GeometryArena::MaxDrawMaterials entries
+    vec4 materialSpecular[128]; // rgb Ks, a Ns
+};
+
+// Variant defines (see ShaderVariants): TEXTURED, SPECULAR, LIGHT_COUNT, INSTANCED
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 1
+#endif
+// Scene-wide: exported MTLs routinely carry Ka 1, which would wash everything out
+const float ambientStrength = 0.1;
 
-// Phong lighting components
-vec3 calculateLighting(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor) {
+// Phong lighting components; specular is the material's Ks and Ns
+vec3 calculateLighting(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor, vec4 specularColor) {
     // Ambient
-    float ambientStrength = 0.1;
     vec3 ambient = ambientStrength * lightColor;
 
     // Diffuse
@@ -21,21 +46,33 @@ vec3 calculateLighting(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor
     float diff = max(dot(normal, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
 
+#ifdef SPECULAR
     // Specular
-    float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 viewDir = normalize(viewPos.xyz - fragPos);
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    vec3 specular = specularStrength * spec * lightColor;
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), specularColor.a);
+    vec3 specular = specularColor.rgb * spec * lightColor;
 
     return (ambient + diffuse + specular);
+#else
+    return (ambient + diffuse);
+#endif
 }
 
 void main() {
     vec3 norm = normalize(Normal);
-    vec3 lighting = calculateLighting(norm, FragPos, lightPos, lightColor);
+    vec3 lighting = vec3(0.0);
+    for (int i = 0; i < LIGHT_COUNT; ++i) {
+        lighting += calculateLighting(norm, FragPos, lightPos[i].xyz, lightColor[i].rgb, materialSpecular[MaterialIndex]);
+    }
 
-    // Apply texture (if exists)
-    vec3 texColor = texture(diffuseMap, TexCoord).rgb;
-    FragColor = vec4(lighting * texColor, 1.0);
+#ifdef TEXTURED
+    vec3 baseColor = texture(diffuseMap, TexCoord).rgb;  // the texture alone, as before the palette
+#else
+    vec3 baseColor = materialDiffuse[MaterialIndex].rgb;
+#endif
+#ifdef INSTANCED
+    baseColor *= Tint;
+#endif
+    FragColor = vec4(lighting * baseColor, 1.0);
 }
\ No newline at end of file
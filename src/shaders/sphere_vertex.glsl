@@ -1,9 +1,24 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame constants, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;                // Camera position
+    vec4 lightPos[MAX_LIGHTS];   // Light positions (the sphere's is the first)
+    vec4 lightColor[MAX_LIGHTS]; // Light colors (e.g., white)
+    uint lightCount;
+};
+
+// Per-object constants, see ObjectUniforms
+layout(std140) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;   // Inverse transpose of model in the upper 3x3
+    vec4 positionOffset; // Vertex format decode, identity for float vertices
+    vec4 positionScale;
+    uint materialIndex;  // Instanced draws only
+};
 
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -1,20 +1,75 @@
 #version 330 core
-layout (location = 0) in vec3 aPos; // Vertex position
+layout (location = 0) in vec3 aPos; // Vertex position (unorm16 within the mesh bounds when packed)
 layout (location = 1) in vec2 aTexCoord; // Texture coordinate
-layout (location = 2) in vec3 aNormal; // Vertex normal
+layout (location = 2) in vec3 aNormal; // Vertex normal (octahedral-encoded in .xy when packed)
+#ifndef INSTANCED
+layout (location = 3) in uint aMaterialIndex; // Per-draw material index (the draw's baseInstance)
+#endif
 
 out vec2 TexCoord; // Pass to fragment shader
 out vec3 FragPos; // Fragment position (for lighting)
 out vec3 Normal; // Normal (for lighting)
+flat out uint MaterialIndex; // Index into the Materials block
+#ifdef INSTANCED
+flat out vec3 Tint; // Per-instance color multiplier
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per instance: four model matrix columns, then the tint (see InstanceBuffer)
+uniform samplerBuffer instanceData;
+#endif
+
+// Per-frame constants, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;                // Camera position
+    vec4 lightPos[MAX_LIGHTS];   // Light positions (the sphere's is the first)
+    vec4 lightColor[MAX_LIGHTS]; // Light colors (e.g., white)
+    uint lightCount;
+};
+
+// Per-object constants, see ObjectUniforms
+layout(std140) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;   // Inverse transpose of model in the upper 3x3
+    vec4 positionOffset; // Vertex format decode, identity for float vertices
+    vec4 positionScale;
+    uint materialIndex;  // Instanced draws only
+};
+
+#ifdef PACKED_VERTICES
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#endif
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+#ifdef PACKED_VERTICES
+    vec3 position = positionOffset.xyz + aPos * positionScale.xyz;
+    vec3 normal = octDecode(aNormal.xy);
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+#endif
+
+#ifdef INSTANCED
+    // Instances place copies of the object; their transforms are rigid plus uniform scale
+    int texel = gl_InstanceID * 5;
+    mat4 instance = mat4(texelFetch(instanceData, texel), texelFetch(instanceData, texel + 1),
+                         texelFetch(instanceData, texel + 2), texelFetch(instanceData, texel + 3));
+    FragPos = vec3(instance * (model * vec4(position, 1.0)));
+    Normal = mat3(instance) * (mat3(normalMatrix) * normal);
+    MaterialIndex = materialIndex;
+    Tint = texelFetch(instanceData, texel + 4).rgb;
+#else
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(normalMatrix) * normal;
+    MaterialIndex = aMaterialIndex;
+#endif
     TexCoord = aTexCoord;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
+}
\ No newline at end of file